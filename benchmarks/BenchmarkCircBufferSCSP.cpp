@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+  Measures the throughput of CircBufferSCSP with different locking policies,
+  with one producer and one consumer thread passing small chunks.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+#include "../src/CircBufferSCSP.h"
+
+
+namespace {
+
+constexpr std::size_t const totalBytes = 256u * 1024u * 1024u;
+constexpr std::size_t const chunkSize = 64u;
+
+template <typename Locking>
+void benchmark(char const * const name) {
+    sharemind::CircBufferSCSP<char, Locking> buffer(64u * 1024u);
+    auto const start(std::chrono::steady_clock::now());
+    std::thread producer(
+                [&buffer]() {
+                    char chunk[chunkSize] = {};
+                    for (std::size_t left = totalBytes; left;) {
+                        auto const n(buffer.write(chunk, chunkSize));
+                        if (!n)
+                            std::this_thread::yield();
+                        left -= n;
+                    }
+                });
+    char chunk[chunkSize];
+    for (std::size_t left = totalBytes; left;) {
+        auto const n(buffer.read(chunk, chunkSize));
+        if (!n)
+            std::this_thread::yield();
+        left -= n;
+    }
+    producer.join();
+    auto const elapsed(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start));
+    std::printf("%-28s %10.1f MiB/s\n",
+                name,
+                static_cast<double>(totalBytes) / (1024.0 * 1024.0)
+                * 1e6 / static_cast<double>(elapsed.count()));
+}
+
+} // anonymous namespace
+
+int main() {
+    benchmark<sharemind::CircBufferScspLocking<> >("CircBufferScspLocking");
+    benchmark<sharemind::CircBufferScspLockFree>("CircBufferScspLockFree");
+}
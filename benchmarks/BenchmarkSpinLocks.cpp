@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+  Compares the throughput of the spin locks under contention. Every thread
+  repeatedly acquires the lock, updates some shared state and does some work
+  outside of the critical section.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../src/McsSpinLock.h"
+#include "../src/TicketSpinLock.h"
+
+
+namespace {
+
+constexpr auto benchmarkDuration = std::chrono::milliseconds(500);
+
+template <typename Lock>
+void benchmark(char const * const name, unsigned const numThreads) {
+    Lock lock;
+    std::size_t shared[8u] = {};
+    std::atomic<bool> start(false);
+    std::atomic<bool> stop(false);
+    std::atomic<std::size_t> totalOps(0u);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0u; i < numThreads; ++i)
+        threads.emplace_back(
+                    [&]() {
+                        std::size_t ops = 0u;
+                        std::size_t local = 0u;
+                        while (!start.load(std::memory_order_acquire))
+                            std::this_thread::yield();
+                        while (!stop.load(std::memory_order_relaxed)) {
+                            {
+                                std::lock_guard<Lock> const guard(lock);
+                                for (auto & v : shared)
+                                    v += local;
+                            }
+                            for (unsigned j = 0u; j < 50u; ++j)
+                                local = local * 31u + j;
+                            ++ops;
+                        }
+                        totalOps.fetch_add(ops, std::memory_order_relaxed);
+                    });
+    auto const startTime(std::chrono::steady_clock::now());
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(benchmarkDuration);
+    stop.store(true, std::memory_order_relaxed);
+    for (auto & t : threads)
+        t.join();
+    auto const elapsed(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - startTime));
+    std::printf("%-36s %3u threads: %12.0f ops/s\n",
+                name,
+                numThreads,
+                static_cast<double>(totalOps.load())
+                * 1e6 / static_cast<double>(elapsed.count()));
+}
+
+} // anonymous namespace
+
+int main() {
+    unsigned const maxThreads =
+            std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned n = 1u; n <= maxThreads; n *= 2u) {
+        benchmark<std::mutex>("std::mutex", n);
+        benchmark<sharemind::TicketSpinLock>("TicketSpinLock", n);
+        benchmark<sharemind::ProportionalBackoffTicketSpinLock>(
+                    "ProportionalBackoffTicketSpinLock",
+                    n);
+        benchmark<sharemind::AdaptiveBackoffTicketSpinLock>(
+                    "AdaptiveBackoffTicketSpinLock",
+                    n);
+        benchmark<sharemind::McsSpinLock>("McsSpinLock", n);
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+  Compares insertion and lookup throughput of UnorderedMap, FlatUnorderedMap
+  and std::unordered_map with symbol table like string keys. Half of the
+  lookups miss.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../src/FlatUnorderedMap.h"
+#include "../src/StringHasher.h"
+#include "../src/UnorderedMap.h"
+
+
+namespace {
+
+constexpr std::size_t const lookupRounds = 20u;
+
+template <typename Map>
+void benchmark(char const * const name, std::size_t const numKeys) {
+    std::vector<std::string> keys;
+    for (std::size_t i = 0u; i < numKeys * 2u; ++i)
+        keys.emplace_back("symbol_" + std::to_string(i * 2654435761u));
+
+    using Clock = std::chrono::steady_clock;
+    auto const insertStart(Clock::now());
+    Map m;
+    for (std::size_t i = 0u; i < numKeys; ++i)
+        m.emplace(keys[i], i);
+    auto const lookupStart(Clock::now());
+    std::size_t found = 0u;
+    for (std::size_t round = 0u; round < lookupRounds; ++round)
+        for (auto const & key : keys)
+            found += (m.find(key) != m.end());
+    auto const lookupEnd(Clock::now());
+
+    auto const ns =
+            [](Clock::duration const d, std::size_t const ops) {
+                using std::chrono::nanoseconds;
+                return static_cast<double>(
+                            std::chrono::duration_cast<nanoseconds>(d).count())
+                       / static_cast<double>(ops);
+            };
+    std::printf("%-20s %8zu keys: insert %7.1f ns, find %7.1f ns (%zu)\n",
+                name,
+                numKeys,
+                ns(lookupStart - insertStart, numKeys),
+                ns(lookupEnd - lookupStart, keys.size() * lookupRounds),
+                found);
+}
+
+} // anonymous namespace
+
+int main() {
+    using sharemind::StringHasher;
+    for (std::size_t n = 1000u; n <= 1000000u; n *= 10u) {
+        benchmark<std::unordered_map<std::string, std::size_t, StringHasher> >(
+                    "std::unordered_map",
+                    n);
+        benchmark<sharemind::UnorderedMap<std::string,
+                                          std::size_t,
+                                          StringHasher> >("UnorderedMap", n);
+        benchmark<sharemind::FlatUnorderedMap<std::string,
+                                              std::size_t,
+                                              StringHasher> >(
+                    "FlatUnorderedMap",
+                    n);
+    }
+}
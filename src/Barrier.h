@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_BARRIER_H
+#define SHAREMIND_BARRIER_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include "Futex.h"
+
+
+namespace sharemind {
+
+/**
+  \brief A reusable barrier for a fixed number of threads.
+
+  Every phase completes when the given number of threads have arrived, after
+  which the barrier is immediately ready for the next phase. Arriving is
+  lock-free and the futex is only used when some thread is actually blocked.
+*/
+class Barrier {
+
+public: /* Methods: */
+
+    Barrier(Barrier &&) = delete;
+    Barrier(Barrier const &) = delete;
+    Barrier & operator=(Barrier &&) = delete;
+    Barrier & operator=(Barrier const &) = delete;
+
+    Barrier(std::uint32_t const numThreads)
+        : m_numThreads((assert(numThreads > 0u), numThreads))
+        , m_remaining(numThreads)
+    {}
+
+    /**
+      \brief Arrives at the barrier and blocks until all threads have arrived
+             in the current phase.
+      \returns whether the calling thread was the last to arrive.
+    */
+    bool arriveAndWait() noexcept {
+        /* The phase can not change before we have arrived: */
+        auto state = m_state.load(std::memory_order_acquire);
+        auto const phase = state & PHASE_MASK;
+        if (m_remaining.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+            m_remaining.store(m_numThreads, std::memory_order_relaxed);
+            if (m_state.exchange((phase + PHASE_INCREMENT) & PHASE_MASK,
+                                 std::memory_order_release) & HAS_WAITERS)
+                futexWakeAll(m_state);
+            return true;
+        }
+        while ((state & PHASE_MASK) == phase) {
+            if (!(state & HAS_WAITERS)
+                && !m_state.compare_exchange_weak(state,
+                                                  state | HAS_WAITERS,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_acquire))
+                continue;
+            futexWait(m_state, phase | HAS_WAITERS);
+            state = m_state.load(std::memory_order_acquire);
+        }
+        return false;
+    }
+
+    std::uint32_t numThreads() const noexcept { return m_numThreads; }
+
+private: /* Constants: */
+
+    static constexpr std::uint32_t HAS_WAITERS = 1u;
+    static constexpr std::uint32_t PHASE_INCREMENT = 2u;
+    static constexpr std::uint32_t PHASE_MASK = ~HAS_WAITERS;
+
+private: /* Fields: */
+
+    std::uint32_t const m_numThreads;
+    std::atomic<std::uint32_t> m_remaining;
+    FutexWord m_state{0u};
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_BARRIER_H */
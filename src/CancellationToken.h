@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_CANCELLATIONTOKEN_H
+#define SHAREMIND_CANCELLATIONTOKEN_H
+
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include "detail/ExceptionMacros.h"
+#include "Exception.h"
+#include "Stoppable.h"
+
+
+namespace sharemind {
+
+SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                            CancelledException,
+                                            "Operation cancelled!");
+
+class CancellationSource;
+template <typename F> class CancellationCallback;
+
+namespace Detail {
+namespace Cancellation {
+
+struct CallbackBase {
+
+/* Methods: */
+
+    virtual ~CallbackBase() noexcept {}
+
+    virtual void invoke() noexcept = 0;
+
+/* Fields: */
+
+    CallbackBase * m_prev = nullptr;
+    CallbackBase * m_next = nullptr;
+
+};
+
+class State: public Stoppable {
+
+public: /* Methods: */
+
+    void cancel() noexcept {
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        if (stopRequested())
+            return;
+        stop();
+        for (auto * c = m_callbacks; c; c = c->m_next)
+            c->invoke();
+    }
+
+    /**
+      \returns false if cancellation has already been requested, in which case
+               the callback was not registered.
+    */
+    bool registerCallback(CallbackBase & callback) noexcept {
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        if (stopRequested())
+            return false;
+        assert(!callback.m_prev);
+        assert(!callback.m_next);
+        callback.m_next = m_callbacks;
+        if (m_callbacks)
+            m_callbacks->m_prev = &callback;
+        m_callbacks = &callback;
+        return true;
+    }
+
+    void unregisterCallback(CallbackBase & callback) noexcept {
+        // Also waits for any cancel() running the callback to complete:
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        if (callback.m_prev) {
+            callback.m_prev->m_next = callback.m_next;
+        } else {
+            assert(m_callbacks == &callback);
+            m_callbacks = callback.m_next;
+        }
+        if (callback.m_next)
+            callback.m_next->m_prev = callback.m_prev;
+    }
+
+private: /* Fields: */
+
+    std::mutex m_mutex;
+    CallbackBase * m_callbacks = nullptr;
+
+};
+
+} /* namespace Cancellation { */
+} /* namespace Detail { */
+
+/**
+  \brief A cheaply copyable handle for querying whether cancellation has been
+         requested via the associated CancellationSource.
+
+  A default-constructed token is never cancelled.
+*/
+class CancellationToken {
+
+    friend class CancellationSource;
+    template <typename> friend class CancellationCallback;
+
+public: /* Methods: */
+
+    CancellationToken() noexcept {}
+
+    /** \returns whether this token is associated with a CancellationSource. */
+    bool canBeCancelled() const noexcept
+    { return static_cast<bool>(m_state); }
+
+    bool isCancelled() const noexcept
+    { return m_state && m_state->stopRequested(); }
+
+    /** \throws CancelledException if cancellation has been requested. */
+    void throwIfCancelled() const {
+        if (isCancelled())
+            throw CancelledException();
+    }
+
+    void swap(CancellationToken & other) noexcept
+    { return m_state.swap(other.m_state); }
+
+private: /* Methods: */
+
+    explicit CancellationToken(
+            std::shared_ptr<Detail::Cancellation::State> state) noexcept
+        : m_state(std::move(state))
+    {}
+
+private: /* Fields: */
+
+    std::shared_ptr<Detail::Cancellation::State> m_state;
+
+};
+
+/** \brief Used to request cancellation of operations holding its tokens. */
+class CancellationSource {
+
+public: /* Methods: */
+
+    CancellationSource()
+        : m_state(std::make_shared<Detail::Cancellation::State>())
+    {}
+
+    CancellationToken token() const noexcept
+    { return CancellationToken(m_state); }
+
+    /**
+      \brief Requests cancellation and synchronously invokes all callbacks
+             registered via the tokens of this source.
+    */
+    void cancel() noexcept { return m_state->cancel(); }
+
+    bool isCancelled() const noexcept { return m_state->stopRequested(); }
+
+private: /* Fields: */
+
+    std::shared_ptr<Detail::Cancellation::State> m_state;
+
+};
+
+/**
+  \brief Invokes the given callback once when cancellation is requested via the
+         given token for the lifetime of this object.
+
+  If cancellation has already been requested, the callback is invoked from the
+  constructor. Otherwise it is invoked by the thread calling cancel(). The
+  destructor waits for any such invocation in progress to complete, hence the
+  callback must not destroy a CancellationCallback of the same source.
+*/
+template <typename F>
+class CancellationCallback final
+        : private Detail::Cancellation::CallbackBase
+{
+
+public: /* Methods: */
+
+    template <typename F_>
+    CancellationCallback(CancellationToken const & token, F_ && f)
+            noexcept(std::is_nothrow_constructible<F, F_ &&>::value)
+        : m_f(std::forward<F_>(f))
+        , m_state(token.m_state)
+    {
+        static_assert(noexcept(m_f()), "The callback must be noexcept!");
+        if (m_state && !m_state->registerCallback(*this)) {
+            m_state.reset();
+            m_f();
+        }
+    }
+
+    CancellationCallback(CancellationCallback const &) = delete;
+    CancellationCallback & operator=(CancellationCallback const &) = delete;
+
+    ~CancellationCallback() noexcept override {
+        if (m_state)
+            m_state->unregisterCallback(*this);
+    }
+
+private: /* Methods: */
+
+    void invoke() noexcept final { m_f(); }
+
+private: /* Fields: */
+
+    F m_f;
+    std::shared_ptr<Detail::Cancellation::State> m_state;
+
+};
+
+} /* namespace sharemind { */
+
+namespace std {
+
+inline void swap(sharemind::CancellationToken & lhs,
+                 sharemind::CancellationToken & rhs) noexcept
+{ return lhs.swap(rhs); }
+
+} /* namespace std { */
+
+#endif /* SHAREMIND_CANCELLATIONTOKEN_H */
@@ -21,15 +21,35 @@
 #define SHAREMIND_CIRCBUFFERSCSP_H
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <sharemind/AlignToCacheLine.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <type_traits>
 #include <utility>
+#include "CancellationToken.h"
+#include "Detected.h"
+#include "Exception.h"
 #include "FunctionTraits.h"
+#include "Futex.h"
+#include "Posix.h"
 #include "PotentiallyVoidTypeInfo.h"
 
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "ScopeExit.h"
+#include "ThrowNested.h"
+#endif
+
 
 namespace sharemind {
 namespace Detail {
@@ -98,6 +118,19 @@ public: /* Methods: */
     template <typename Lock> void wait(Lock & lock)
     { return m_dataAvailableCondition.wait(lock); }
 
+    /** \returns false on timeout, true otherwise. */
+    template <typename Lock, typename TimePoint>
+    bool wait_until(Lock & lock, TimePoint const & timePoint) {
+        return m_dataAvailableCondition.wait_until(lock, timePoint)
+               == std::cv_status::no_timeout;
+    }
+
+    /** \brief Wakes all threads blocked waiting. */
+    void notifyAll() noexcept {
+        std::lock_guard<MutexType> const guard(m_dataAvailableMutex);
+        m_dataAvailableCondition.notify_all();
+    }
+
 private: /* Fields: */
 
     mutable MutexType m_dataAvailableMutex;
@@ -133,39 +166,422 @@ private: /* Fields: */
 
 };
 
+/**
+  \brief A lock-free locking policy for a single producer and a single consumer.
+
+  The producer and the consumer each own a monotonically increasing counter of
+  elements written and read respectively, kept on separate cache lines. Both
+  sides also keep a private cached copy of the counter of the other side, which
+  is only refreshed when the cached view indicates that the buffer is full (for
+  the producer) or empty (for the consumer). Hence most reads and writes do not
+  touch the cache line owned by the other side. The values returned from
+  increaseDataAvailable() and decreaseDataAvailable() are computed from these
+  cached copies, and are therefore an upper and a lower bound respectively.
+  The cached copy is also refreshed if it has fallen so far behind that it
+  would not yield such a bound, e.g. because the caller committed elements it
+  learned about from dataAvailable(). For the producer, this is detected by
+  CircBufferSCSP, as the policy does not know the size of the buffer.
+
+  Waiting is implemented using a futex word which is only signalled when some
+  thread is actually blocked waiting. Checking for waiters costs a full fence
+  after every update of a counter, but the waiter count itself lives on a
+  cache line which is only written when threads start or stop waiting.
+*/
+class CircBufferScspLockFree {
+
+public: /* Constants: */
+
+    constexpr static bool providesWait = true;
+
+public: /* Types: */
+
+    class ScopedReadLock {
+
+        friend class CircBufferScspLockFree;
+
+    public: /* Methods: */
+
+        ScopedReadLock(CircBufferScspLockFree & locking) noexcept
+            : m_locking(locking)
+        {
+            m_locking.m_waiters.fetch_add(1u, std::memory_order_seq_cst);
+            m_epoch = m_locking.m_epoch.load(std::memory_order_seq_cst);
+        }
+
+        ScopedReadLock(ScopedReadLock const &) = delete;
+        ScopedReadLock & operator=(ScopedReadLock const &) = delete;
+
+        ~ScopedReadLock() noexcept
+        { m_locking.m_waiters.fetch_sub(1u, std::memory_order_relaxed); }
+
+    private: /* Fields: */
+
+        CircBufferScspLockFree & m_locking;
+        std::uint32_t m_epoch;
+
+    };
+
+public: /* Methods: */
+
+    #ifndef NDEBUG
+    CircBufferScspLockFree() noexcept {
+        assert(m_written.is_lock_free());
+        assert(m_read.is_lock_free());
+    }
+    #endif
+
+    std::size_t dataAvailable() const noexcept {
+        /* Load the read counter first, so that the result is never less than
+           the actual value when called by the producer, and never more than
+           the actual value when called by the consumer: */
+        auto const read = m_read.load(std::memory_order_acquire);
+        return m_written.load(std::memory_order_acquire) - read;
+    }
+
+    std::size_t dataAvailableNoLocking() const noexcept
+    { return dataAvailable(); }
+
+    /**
+      \returns an upper bound on the number of elements pending, as seen by the
+               producer.
+      \note Only to be called by the producer.
+    */
+    std::size_t producerDataAvailable(std::size_t const bufferSize) noexcept {
+        auto const written = m_written.load(std::memory_order_relaxed);
+        auto r = written - m_producerCachedRead;
+        if (r >= bufferSize) {
+            m_producerCachedRead = m_read.load(std::memory_order_acquire);
+            r = written - m_producerCachedRead;
+        }
+        return r;
+    }
+
+    /**
+      \returns a lower bound on the number of elements pending, as seen by the
+               consumer.
+      \note Only to be called by the consumer.
+    */
+    std::size_t consumerDataAvailable() noexcept {
+        auto const read = m_read.load(std::memory_order_relaxed);
+        if (m_consumerCachedWritten <= read)
+            m_consumerCachedWritten = m_written.load(std::memory_order_acquire);
+        return m_consumerCachedWritten - read;
+    }
+
+    std::size_t increaseDataAvailable(std::size_t const size) noexcept {
+        auto const written = m_written.load(std::memory_order_relaxed) + size;
+        m_written.store(written, std::memory_order_release);
+        notify();
+        return written - m_producerCachedRead;
+    }
+
+    std::size_t decreaseDataAvailable(std::size_t const size) noexcept {
+        auto const read = m_read.load(std::memory_order_relaxed) + size;
+        assert(m_written.load(std::memory_order_relaxed) >= read);
+        m_read.store(read, std::memory_order_release);
+        notify();
+        if (m_consumerCachedWritten < read)
+            m_consumerCachedWritten = m_written.load(std::memory_order_acquire);
+        return m_consumerCachedWritten - read;
+    }
+
+    template <typename LoopDuration>
+    void wait_for(ScopedReadLock & lock, LoopDuration && loopDuration) {
+        futexWaitFor(m_epoch,
+                     lock.m_epoch,
+                     std::forward<LoopDuration>(loopDuration));
+        lock.m_epoch = m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    void wait(ScopedReadLock & lock) {
+        futexWait(m_epoch, lock.m_epoch);
+        lock.m_epoch = m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    /** \returns false on timeout, true otherwise. */
+    template <typename Duration>
+    bool wait_until(
+            ScopedReadLock & lock,
+            std::chrono::time_point<std::chrono::steady_clock, Duration> const &
+                timePoint)
+    {
+        bool const r = futexWaitUntil(m_epoch, lock.m_epoch, timePoint);
+        lock.m_epoch = m_epoch.load(std::memory_order_seq_cst);
+        return r;
+    }
+
+    /** \brief Wakes all threads blocked waiting. */
+    void notifyAll() noexcept {
+        m_epoch.fetch_add(1u, std::memory_order_seq_cst);
+        futexWakeAll(m_epoch);
+    }
+
+private: /* Methods: */
+
+    void notify() noexcept {
+        /* Pairs with the waiter registration in ScopedReadLock, so that either
+           the waiter observes the new counter value or we observe the waiter:*/
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) != 0u)
+            notifyAll();
+    }
+
+private: /* Fields: */
+
+    /* Producer side: */
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<std::size_t> m_written{0u};
+    std::size_t m_producerCachedRead = 0u;
+
+    /* Consumer side: */
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<std::size_t> m_read{0u};
+    std::size_t m_consumerCachedWritten = 0u;
+
+    /* Waiting: */
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<std::size_t> m_waiters{0u};
+    FutexWord m_epoch{0u};
+
+};
+
+/** \brief Storage for CircBufferSCSP allocated from the free store. */
+template <typename T>
+class CircBufferHeapStorage {
+
+public: /* Constants: */
+
+    constexpr static bool isMirrored = false;
+
+public: /* Types: */
+
+    using ValueAllocType = AllocType<T>;
+
+public: /* Methods: */
+
+    CircBufferHeapStorage(std::size_t const bufferSize)
+        // Don't use std::make_unique to avoid unnecessary zero-initialization:
+        : m_buffer(new ValueAllocType[bufferSize])
+        , m_size(bufferSize)
+    {}
+
+    ValueAllocType * data() const noexcept { return m_buffer.get(); }
+    std::size_t size() const noexcept { return m_size; }
+
+private: /* Fields: */
+
+    std::unique_ptr<ValueAllocType[]> const m_buffer;
+    std::size_t const m_size;
+
+};
+
+#if defined(__linux__)
+/**
+  \brief Storage for CircBufferSCSP which maps the same anonymous memory file
+         twice, back to back, in virtual memory.
+
+  Element i of the buffer is also accessible as element i + size(), hence any
+  pending data or free space in the buffer is always a single contiguous range
+  starting at the respective offset, and the buffer never needs to wrap.
+
+  \note The requested buffer size is rounded up so that the buffer occupies a
+        whole number of memory pages.
+*/
+template <typename T>
+class CircBufferMirroredStorage {
+
+public: /* Constants: */
+
+    constexpr static bool isMirrored = true;
+
+public: /* Types: */
+
+    using ValueAllocType = AllocType<T>;
+    static_assert(std::is_trivially_copyable<ValueAllocType>::value,
+                  "Mirrored storage requires trivially copyable elements!");
+
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION(sharemind::Exception, Exception);
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                                MemfdCreateException,
+                                                "memfd_create() failed!");
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                                FtruncateException,
+                                                "ftruncate() failed!");
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                                MmapException,
+                                                "mmap() failed!");
+
+public: /* Methods: */
+
+    CircBufferMirroredStorage(std::size_t const bufferSize)
+        : m_bytes(roundUpBytes(bufferSize))
+    {
+        int const fd =
+                syscallLoop<MemfdCreateException>(
+                    ::memfd_create,
+                    [](int const r) noexcept { return r != -1; },
+                    "CircBufferSCSP",
+                    MFD_CLOEXEC);
+        SHAREMIND_SCOPE_EXIT(::close(fd));
+        syscallLoop<FtruncateException>(
+                    ::ftruncate,
+                    [](int const r) noexcept { return r == 0; },
+                    fd,
+                    static_cast<::off_t>(m_bytes));
+
+        // Reserve an address range for both mappings:
+        void * const reserved = ::mmap(nullptr,
+                                       m_bytes * 2u,
+                                       PROT_NONE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS,
+                                       -1,
+                                       0);
+        if (reserved == MAP_FAILED)
+            throwNested(ErrnoException(errno), MmapException());
+        try {
+            mapAt(reserved, fd);
+            mapAt(ptrAdd(static_cast<unsigned char *>(reserved), m_bytes), fd);
+        } catch (...) {
+            ::munmap(reserved, m_bytes * 2u);
+            throw;
+        }
+        m_mapping = static_cast<ValueAllocType *>(reserved);
+    }
+
+    CircBufferMirroredStorage(CircBufferMirroredStorage const &) = delete;
+    CircBufferMirroredStorage & operator=(CircBufferMirroredStorage const &)
+            = delete;
+
+    ~CircBufferMirroredStorage() noexcept
+    { ::munmap(static_cast<void *>(m_mapping), m_bytes * 2u); }
+
+    ValueAllocType * data() const noexcept { return m_mapping; }
+    std::size_t size() const noexcept
+    { return m_bytes / sizeOf<ValueAllocType>(); }
+
+private: /* Methods: */
+
+    static std::size_t roundUpBytes(std::size_t const bufferSize) noexcept {
+        std::size_t const pageSize =
+                static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        // The least common multiple of the page and the element sizes:
+        std::size_t unit = pageSize;
+        while (unit % sizeOf<ValueAllocType>())
+            unit += pageSize;
+        std::size_t const bytes =
+                std::max(bufferSize, std::size_t(1u))
+                * sizeOf<ValueAllocType>();
+        return ((bytes + unit - 1u) / unit) * unit;
+    }
+
+    void mapAt(void * const address, int const fd) const {
+        if (::mmap(address,
+                   m_bytes,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FIXED,
+                   fd,
+                   0) == MAP_FAILED)
+            throwNested(ErrnoException(errno), MmapException());
+    }
+
+private: /* Fields: */
+
+    std::size_t const m_bytes;
+    ValueAllocType * m_mapping;
+
+};
+#endif
+
+/** \brief The result of a timed or cancellable wait on a CircBufferSCSP. */
+enum class CircBufferWaitStatus {
+    Ready,
+    Timeout,
+    Cancelled
+};
+
 namespace Detail {
 
-template <typename T, typename Locking, bool = Locking::providesWait>
+template <typename T,
+          typename Locking,
+          typename Storage,
+          bool = Locking::providesWait>
 class CircBufferBase2;
 
+template <typename Locking>
+using CircBufferProducerDataAvailable =
+        decltype(std::declval<Locking &>().producerDataAvailable(
+                     std::declval<std::size_t>()));
+
+template <typename Locking>
+using CircBufferConsumerDataAvailable =
+        decltype(std::declval<Locking &>().consumerDataAvailable());
+
+template <typename Locking>
+std::size_t circBufferProducerDataAvailable(Locking & locking,
+                                            std::size_t const bufferSize,
+                                            std::true_type) noexcept
+{ return locking.producerDataAvailable(bufferSize); }
+
+template <typename Locking>
+std::size_t circBufferProducerDataAvailable(Locking & locking,
+                                            std::size_t,
+                                            std::false_type) noexcept
+{ return locking.dataAvailable(); }
+
+template <typename Locking>
+std::size_t circBufferConsumerDataAvailable(Locking & locking, std::true_type)
+        noexcept
+{ return locking.consumerDataAvailable(); }
+
+template <typename Locking>
+std::size_t circBufferConsumerDataAvailable(Locking & locking, std::false_type)
+        noexcept
+{ return locking.dataAvailable(); }
+
 /**
  * \brief A one producer, one consumer thread circular FIFO buffer.
 */
-template <typename T, typename Locking_>
+template <typename T, typename Locking_, typename Storage_>
 class CircBufferBase {
 
-    template <typename, typename, bool>
+    template <typename, typename, typename, bool>
     friend class CircBufferBase2;
 
 private: /* Types: */
 
     using Locking = Locking_;
-    using Self = CircBufferBase<T, Locking>;
+    using Storage = Storage_;
+    using Self = CircBufferBase<T, Locking, Storage>;
+
+public: /* Constants: */
+
+    /**
+      Whether the storage is mirrored, i.e. whether pending data and free space
+      are always contiguous starting at readOffset() and writeOffset().
+    */
+    constexpr static bool isMirrored = Storage::isMirrored;
 
 public: /* Types: */
 
     using ValueType = T;
     using ValueAllocType = AllocType<T>;
 
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION(sharemind::Exception, Exception);
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                                ReadvException,
+                                                "readv() failed!");
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                                WritevException,
+                                                "writev() failed!");
+    SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                                EndOfFileException,
+                                                "End of file reached!");
+
 public: /* Methods: */
 
     CircBufferBase(Self const &) = delete;
     Self & operator=(Self const &) = delete;
 
     CircBufferBase(std::size_t const bufferSize = 1024u * 1024u)
-        // Don't use std::make_unique to avoid unnecessary zero-initialization:
-        : m_buffer(new ValueAllocType[bufferSize])
-        , m_bufferSize(bufferSize)
+        : m_buffer(bufferSize)
+        , m_bufferSize(m_buffer.size())
         , m_readOffset(0u)
         , m_writeOffset(0u)
     {}
@@ -173,8 +589,12 @@ public: /* Methods: */
     /** \returns the buffer size. */
     std::size_t bufferSize() const noexcept { return m_bufferSize; }
 
-    /** \returns a pointer to the circular FIFO storage array. */
-    ValueType * arrayStart() const noexcept { return m_buffer.get(); }
+    /**
+      \returns a pointer to the circular FIFO storage array.
+      \note If the storage is mirrored, the array is accessible as having twice
+            the buffer size, with the second half aliasing the first.
+    */
+    ValueType * arrayStart() const noexcept { return m_buffer.data(); }
 
 
     /***************************************************************************
@@ -202,14 +622,25 @@ public: /* Methods: */
         assert(m_writeOffset < m_bufferSize);
         std::size_t const available = spaceAvailable();
         assert(available <= m_bufferSize);
-        availableUntilBufferEnd = std::min(available,
-                                           m_bufferSize - m_writeOffset);
+        availableUntilBufferEnd =
+                std::min(available, untilBufferEnd(m_writeOffset));
         return available;
     }
 
-    /** \returns the number of elements free before the buffer array wraps. */
-    std::size_t spaceAvailableUntilBufferEnd() const noexcept
-    { return std::min(spaceAvailable(), m_bufferSize - m_writeOffset); }
+    /**
+     * \returns the number of elements free before the buffer array wraps.
+     * \note If the locking policy caches the consumer state, the result might
+     *       be less than the actual number of elements free.
+    */
+    std::size_t spaceAvailableUntilBufferEnd() const noexcept {
+        std::size_t const da =
+                circBufferProducerDataAvailable(
+                    m_locking,
+                    m_bufferSize,
+                    IsDetected<CircBufferProducerDataAvailable, Locking>());
+        assert(da <= m_bufferSize);
+        return std::min(m_bufferSize - da, untilBufferEnd(m_writeOffset));
+    }
 
     /** \returns the current write offset in the FIFO storage array. */
     std::size_t writeOffset() const noexcept { return m_writeOffset; }
@@ -218,6 +649,8 @@ public: /* Methods: */
      * \brief Marks data as written.
      * \param[in] size The number of elements written to the FIFO.
      * \returns the number of elements free.
+     * \note If the locking policy caches the consumer state, the result might
+     *       be less than the actual number of elements free.
     */
     std::size_t haveWritten(std::size_t const size) noexcept {
         std::size_t const ret = increaseDataAvailable(size);
@@ -248,7 +681,7 @@ public: /* Methods: */
     */
     std::size_t haveWrittenRetUbe(std::size_t const size) noexcept {
         std::size_t const ret = haveWritten(size);
-        return std::min(ret, m_bufferSize - m_writeOffset);
+        return std::min(ret, untilBufferEnd(m_writeOffset));
     }
 
     /**
@@ -261,6 +694,34 @@ public: /* Methods: */
     std::size_t write(T const * data, std::size_t const size) noexcept
     { return operate<WriteActions>(data, size); }
 
+    /**
+     * \brief Reads data from the given file descriptor directly into the free
+     *        space of the buffer using a single readv() call.
+     * \param[in] fd The file descriptor to read from.
+     * \returns the number of elements written to the buffer, which is zero if
+     *          the buffer is full or if no data is available on a non-blocking
+     *          file descriptor.
+     * \throws EndOfFileException if the buffer is not full and end-of-file
+     *         was reached, e.g. because the peer closed the connection.
+     * \throws ReadvException if readv() failed with an error other than
+     *         EAGAIN, EWOULDBLOCK or EINTR.
+    */
+    std::size_t readFromFd(int const fd) {
+        static_assert(sizeOf<T>() == 1u, "Only supported for byte buffers!");
+        struct ::iovec iov[2u];
+        int const numRegions = regions(iov, spaceAvailable(), m_writeOffset);
+        if (numRegions <= 0)
+            return 0u;
+        auto const r(vectorIo<ReadvException>(::readv, fd, iov, numRegions));
+        if (r < 0)
+            return 0u;
+        if (r == 0)
+            throw EndOfFileException();
+        auto const size = static_cast<std::size_t>(r);
+        haveWrittenNoRet(size);
+        return size;
+    }
+
 
     /***************************************************************************
      * Procedures for consumer */
@@ -284,14 +745,24 @@ public: /* Methods: */
         assert(m_readOffset < m_bufferSize);
         std::size_t const available = dataAvailable();
         assert(available <= m_bufferSize);
-        availableUntilBufferEnd = std::min(available,
-                                           m_bufferSize - m_readOffset);
+        availableUntilBufferEnd =
+                std::min(available, untilBufferEnd(m_readOffset));
         return available;
     }
 
-    /** \returns the number of elements pending before the array wraps. */
-    std::size_t dataAvailableUntilBufferEnd() const noexcept
-    { return std::min(dataAvailable(), m_bufferSize - m_readOffset); }
+    /**
+     * \returns the number of elements pending before the array wraps.
+     * \note If the locking policy caches the producer state, the result might
+     *       be less than the actual number of elements pending.
+    */
+    std::size_t dataAvailableUntilBufferEnd() const noexcept {
+        std::size_t const da =
+                circBufferConsumerDataAvailable(
+                    m_locking,
+                    IsDetected<CircBufferConsumerDataAvailable, Locking>());
+        assert(da <= m_bufferSize);
+        return std::min(da, untilBufferEnd(m_readOffset));
+    }
 
     /** \returns the current read offset in the FIFO storage array. */
     std::size_t readOffset() const noexcept { return m_readOffset; }
@@ -300,6 +771,8 @@ public: /* Methods: */
      * \brief Marks data as consumed.
      * \param[in] size The number of elements to drop from the FIFO.
      * \returns the number of elements pending.
+     * \note If the locking policy caches the producer state, the result might
+     *       be less than the actual number of elements pending.
     */
     std::size_t haveRead(std::size_t const size) noexcept {
         std::size_t const ret = decreaseDataAvailable(size);
@@ -330,7 +803,7 @@ public: /* Methods: */
     */
     std::size_t haveReadRetUbe(std::size_t const size) noexcept {
         std::size_t const ret = haveRead(size);
-        return std::min(ret, m_bufferSize - m_readOffset);
+        return std::min(ret, untilBufferEnd(m_readOffset));
     }
 
     /**
@@ -343,11 +816,91 @@ public: /* Methods: */
     std::size_t read(T * const buffer, std::size_t const size) noexcept
     { return operate<ReadActions>(buffer, size); }
 
+    /**
+     * \brief Writes pending data directly from the buffer to the given file
+     *        descriptor using a single writev() call.
+     * \param[in] fd The file descriptor to write to.
+     * \returns the number of elements consumed from the buffer, which is zero
+     *          if the buffer is empty or if a non-blocking file descriptor is
+     *          not ready for writing.
+     * \throws WritevException if writev() failed with an error other than
+     *         EAGAIN, EWOULDBLOCK or EINTR.
+    */
+    std::size_t writeToFd(int const fd) {
+        static_assert(sizeOf<T>() == 1u, "Only supported for byte buffers!");
+        struct ::iovec iov[2u];
+        int const numRegions = regions(iov, dataAvailable(), m_readOffset);
+        if (numRegions <= 0)
+            return 0u;
+        auto const r(vectorIo<WritevException>(::writev, fd, iov, numRegions));
+        if (r <= 0)
+            return 0u;
+        auto const size = static_cast<std::size_t>(r);
+        haveReadNoRet(size);
+        return size;
+    }
+
 private: /* Methods: */
 
+    /**
+      \brief Calls readv() or writev(), retrying only if interrupted.
+      \returns the number of bytes transferred, or -1 if the call would block.
+    */
+    template <typename Exception, typename F>
+    static ::ssize_t vectorIo(F f,
+                              int const fd,
+                              struct ::iovec const * const iov,
+                              int const numRegions)
+    {
+        for (;;) {
+            auto const r = f(fd, iov, numRegions);
+            if (r >= 0)
+                return r;
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                return -1;
+            if (errno != EINTR)
+                throwNested(ErrnoException(errno), Exception());
+        }
+    }
+
+    std::size_t untilBufferEnd(std::size_t const offset) const noexcept {
+        assert(offset < m_bufferSize);
+        return isMirrored ? m_bufferSize : (m_bufferSize - offset);
+    }
+
+    /**
+     * \brief Fills the given I/O vector with the (up to two) contiguous ranges
+     *        of the given total size starting at the given offset.
+     * \returns the number of ranges.
+    */
+    int regions(struct ::iovec * const iov,
+                std::size_t const available,
+                std::size_t const offset) const noexcept
+    {
+        if (available <= 0u)
+            return 0;
+        std::size_t const first = std::min(available, untilBufferEnd(offset));
+        iov[0u].iov_base = ptrAdd(m_buffer.data(), offset);
+        iov[0u].iov_len = first;
+        if (first == available)
+            return 1;
+        iov[1u].iov_base = m_buffer.data();
+        iov[1u].iov_len = available - first;
+        return 2;
+    }
+
     std::size_t increaseDataAvailable(std::size_t const size) noexcept {
         assert(size <= m_bufferSize);
-        return m_locking.increaseDataAvailable(size);
+        auto const r = m_locking.increaseDataAvailable(size);
+        if (r <= m_bufferSize)
+            return r;
+        /* The locking policy computed the result from a stale cached state of
+           the consumer, which the producer has overtaken using information
+           from dataAvailable() or spaceAvailable(), so refresh it: */
+        return circBufferProducerDataAvailable(
+                    m_locking,
+                    m_bufferSize,
+                    IsDetected<CircBufferProducerDataAvailable, Locking>());
     }
 
     std::size_t decreaseDataAvailable(std::size_t const size) noexcept {
@@ -374,7 +927,7 @@ private: /* Methods: */
             }
             assert(size > aUBE);
             Actions::copyAction(Actions::operatePtr(this), copyPtr, aUBE);
-            std::size_t const newAUBE = Actions::doneRetUbe(this, aUBE);
+            std::size_t const newAUBE = doneRetUbe<Actions>(aUBE);
             transferred += aUBE;
             if (newAUBE == 0u)
                 return transferred;
@@ -384,6 +937,20 @@ private: /* Methods: */
         }
     }
 
+    /**
+      \brief Marks data as transferred.
+      \returns the number of elements available until the buffer end, as in
+               Actions::doneRetUbe(), but requeried if none seem available, in
+               case the locking policy computed the former from stale cached
+               state of the other side.
+    */
+    template <typename Actions>
+    std::size_t doneRetUbe(std::size_t const transferred) noexcept {
+        if (auto const r = Actions::doneRetUbe(this, transferred))
+            return r;
+        return Actions::availableUntilBufferEnd(this);
+    }
+
     template <typename Actions, typename Actor>
     std::size_t operate(Actor & actor) noexcept {
         static_assert(
@@ -410,7 +977,7 @@ private: /* Methods: */
             totalTransferred = actor(Actions::operatePtr(this), toTransfer);
             assert(totalTransferred <= toTransfer);
             availableUntilBufferEnd =
-                    Actions::doneRetUbe(this, totalTransferred);
+                    doneRetUbe<Actions>(totalTransferred);
             if ((totalTransferred < toTransfer)
                 || (availableUntilBufferEnd <= 0u))
                 return totalTransferred;
@@ -426,8 +993,7 @@ private: /* Methods: */
                 std::size_t const transferred =
                         actor(Actions::operatePtr(this), toTransfer);
                 assert(transferred <= toTransfer);
-                availableUntilBufferEnd =
-                        Actions::doneRetUbe(this, transferred);
+                availableUntilBufferEnd = doneRetUbe<Actions>(transferred);
                 totalTransferred += transferred;
                 if ((transferred < toTransfer)
                     || (availableUntilBufferEnd <= 0u))
@@ -537,26 +1103,31 @@ public: /* Methods */
 
 private: /* Fields :*/
 
-    std::unique_ptr<ValueAllocType[]> const m_buffer;
+    Storage const m_buffer;
     std::size_t const m_bufferSize;
     std::size_t m_readOffset;
     std::size_t m_writeOffset;
 
     mutable Locking m_locking;
 
-}; /* template <typename T, typename Locking> class CircBufferBase { */
+}; /* template <typename T, typename Locking, typename Storage>
+      class CircBufferBase { */
 
-template <typename T, typename Locking>
-class CircBufferBase2<T, Locking, false>: public CircBufferBase<T, Locking> {
+template <typename T, typename Locking, typename Storage>
+class CircBufferBase2<T, Locking, Storage, false>
+        : public CircBufferBase<T, Locking, Storage>
+{
 
 public: /* Methods: */
 
-    using CircBufferBase<T, Locking>::CircBufferBase;
+    using CircBufferBase<T, Locking, Storage>::CircBufferBase;
 
-}; /* class CircBufferBase2<T, Locking, false> */
+}; /* class CircBufferBase2<T, Locking, Storage, false> */
 
-template <typename T, typename Locking>
-class CircBufferBase2<T, Locking, true>: public CircBufferBase<T, Locking> {
+template <typename T, typename Locking, typename Storage>
+class CircBufferBase2<T, Locking, Storage, true>
+        : public CircBufferBase<T, Locking, Storage>
+{
 
 private: /* Types: */
 
@@ -571,9 +1142,18 @@ private: /* Types: */
         { return in != bufferSize; }
     };
 
+    struct Notifier {
+        void operator()() const noexcept { locking.notifyAll(); }
+        Locking & locking;
+    };
+
+public: /* Types: */
+
+    using WaitStatus = CircBufferWaitStatus;
+
 public: /* Methods: */
 
-    using CircBufferBase<T, Locking>::CircBufferBase;
+    using CircBufferBase<T, Locking, Storage>::CircBufferBase;
 
     /**
      * \brief Waits until there is data pending.
@@ -620,6 +1200,86 @@ public: /* Methods: */
                     std::forward<LoopDuration>(loopDuration));
     }
 
+    /**
+     * \brief Waits until there is space available or cancellation is
+     *        requested via the given token. Unlike the stop test variants, this
+     *        does not wake up periodically.
+     * \param token The cancellation token.
+     * \returns the total number of elements free.
+     * \throws CancelledException if cancellation was requested.
+    */
+    std::size_t waitSpaceAvailable(CancellationToken const & token) const
+    { return waitSpaceAvailable_(token); }
+
+    /**
+     * \brief Waits until there is data pending or cancellation is requested
+     *        via the given token. Unlike the stop test variants, this does not
+     *        wake up periodically.
+     * \param token The cancellation token.
+     * \returns the total number of elements pending.
+     * \throws CancelledException if cancellation was requested.
+    */
+    std::size_t waitDataAvailable(CancellationToken const & token) const
+    { return waitAvailable<HaveDataTest>(token); }
+
+    /**
+     * \brief Waits until there is space available, the given timeout expires
+     *        or cancellation is requested via the given token.
+     * \param duration The timeout.
+     * \param token The cancellation token.
+    */
+    template <typename Rep, typename Period>
+    WaitStatus waitSpaceAvailableFor(
+            std::chrono::duration<Rep, Period> const & duration,
+            CancellationToken const & token = CancellationToken()) const
+    {
+        return waitAvailableUntil<HaveSpaceTest>(
+                    std::chrono::steady_clock::now() + duration,
+                    token);
+    }
+
+    /**
+     * \brief Waits until there is data pending, the given timeout expires or
+     *        cancellation is requested via the given token.
+     * \param duration The timeout.
+     * \param token The cancellation token.
+    */
+    template <typename Rep, typename Period>
+    WaitStatus waitDataAvailableFor(
+            std::chrono::duration<Rep, Period> const & duration,
+            CancellationToken const & token = CancellationToken()) const
+    {
+        return waitAvailableUntil<HaveDataTest>(
+                    std::chrono::steady_clock::now() + duration,
+                    token);
+    }
+
+    /**
+     * \brief Waits until there is space available, the given time point is
+     *        reached or cancellation is requested via the given token.
+     * \param timePoint The deadline.
+     * \param token The cancellation token.
+    */
+    template <typename Duration>
+    WaitStatus waitSpaceAvailableUntil(
+            std::chrono::time_point<std::chrono::steady_clock, Duration> const &
+                timePoint,
+            CancellationToken const & token = CancellationToken()) const
+    { return waitAvailableUntil<HaveSpaceTest>(timePoint, token); }
+
+    /**
+     * \brief Waits until there is data pending, the given time point is
+     *        reached or cancellation is requested via the given token.
+     * \param timePoint The deadline.
+     * \param token The cancellation token.
+    */
+    template <typename Duration>
+    WaitStatus waitDataAvailableUntil(
+            std::chrono::time_point<std::chrono::steady_clock, Duration> const &
+                timePoint,
+            CancellationToken const & token = CancellationToken()) const
+    { return waitAvailableUntil<HaveDataTest>(timePoint, token); }
+
 private: /* Methods: */
 
     template <typename ... Args>
@@ -653,12 +1313,53 @@ private: /* Methods: */
         return lockingImpl.dataAvailableNoLocking();
     }
 
-}; /* class CircBufferBase2<T, Locking, true> */
+    template <typename Condition>
+    std::size_t waitAvailable(CancellationToken const & token) const {
+        Locking & lockingImpl = this->m_locking;
+        /* The callback must be registered before and unregistered after
+           holding the lock, because it acquires the lock itself: */
+        CancellationCallback<Notifier> const callback(token,
+                                                      Notifier{lockingImpl});
+        typename Locking::ScopedReadLock lock(lockingImpl);
+        while (!Condition::test(lockingImpl.dataAvailableNoLocking(),
+                                this->m_bufferSize))
+        {
+            token.throwIfCancelled();
+            lockingImpl.wait(lock);
+        }
+        return lockingImpl.dataAvailableNoLocking();
+    }
+
+    template <typename Condition, typename TimePoint>
+    WaitStatus waitAvailableUntil(TimePoint const & timePoint,
+                                  CancellationToken const & token) const
+    {
+        Locking & lockingImpl = this->m_locking;
+        CancellationCallback<Notifier> const callback(token,
+                                                      Notifier{lockingImpl});
+        typename Locking::ScopedReadLock lock(lockingImpl);
+        while (!Condition::test(lockingImpl.dataAvailableNoLocking(),
+                                this->m_bufferSize))
+        {
+            if (token.isCancelled())
+                return WaitStatus::Cancelled;
+            if (!lockingImpl.wait_until(lock, timePoint))
+                return Condition::test(lockingImpl.dataAvailableNoLocking(),
+                                       this->m_bufferSize)
+                       ? WaitStatus::Ready
+                       : WaitStatus::Timeout;
+        }
+        return WaitStatus::Ready;
+    }
+
+}; /* class CircBufferBase2<T, Locking, Storage, true> */
 
 } /* namespace Detail { */
 
-template <typename T, typename Locking = CircBufferScspLocking<> >
-using CircBufferSCSP = Detail::CircBufferBase2<T, Locking>;
+template <typename T,
+          typename Locking = CircBufferScspLocking<>,
+          typename Storage = CircBufferHeapStorage<T> >
+using CircBufferSCSP = Detail::CircBufferBase2<T, Locking, Storage>;
 
 } /* namespace sharemind { */
 
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_CONCURRENTLRU_H
+#define SHAREMIND_CONCURRENTLRU_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sharemind/AlignToCacheLine.h>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "RwSpinLock.h"
+
+
+namespace sharemind {
+
+/**
+  \brief A thread-safe cache with the retention semantics of LRU.
+
+  The cache is split into a power-of-two number of shards by key hash, each
+  with its own lock and its own share of the size limit. Within every shard up
+  to the size limit of items are kept alive by the cache, and items evicted
+  from the cache are only weakly referenced and remain available for as long
+  as something else keeps them alive, as with LRU.
+
+  Instead of moving an item to the front of a recency list on every hit,
+  recency is approximated with the CLOCK algorithm: a hit on a strongly
+  referenced item only sets its reference bit, which is done under a shared
+  lock. The strongly referenced items of a shard form a ring, and eviction
+  advances the clock hand over the ring, clearing reference bits, until it
+  finds an item which has not been referenced since the hand last passed.
+
+  \tparam SharedMutex the type of the per-shard lock, which must satisfy the
+                      SharedMutex requirements.
+*/
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename SharedMutex = RwSpinLock>
+class ConcurrentLRU {
+
+private: /* Types: */
+
+    using ValuePtr = std::shared_ptr<Value>;
+
+    struct Entry {
+
+    /* Methods: */
+
+        Entry(ValuePtr value) noexcept
+            : strongPtr(std::move(value))
+            , weakPtr(strongPtr)
+        {}
+
+    /* Fields: */
+
+        ValuePtr strongPtr;
+        std::weak_ptr<Value> weakPtr;
+        std::atomic<bool> referenced{true};
+
+        /** Index of this entry in either Shard::clock or Shard::weak. */
+        std::size_t index = 0u;
+
+    };
+
+    using EntryMap = std::unordered_map<Key, Entry, Hash>;
+    using EntryPtr = typename EntryMap::value_type *;
+
+    struct SHAREMIND_ALIGN_TO_CACHE_SIZE Shard {
+
+    /* Methods: */
+
+        SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(Shard))
+
+        /** \brief Adds the given entry to the clock ring, evicting if full. */
+        void makeStrong(EntryPtr const entry) noexcept {
+            auto & e = entry->second;
+            e.referenced.store(true, std::memory_order_relaxed);
+            if (clock.size() < sizeLimit) {
+                e.index = clock.size();
+                clock.push_back(entry);
+                return;
+            }
+            for (;; hand = (hand + 1u) % clock.size()) {
+                auto & victim = clock[hand]->second;
+                if (!victim.referenced.load(std::memory_order_relaxed))
+                    break;
+                victim.referenced.store(false, std::memory_order_relaxed);
+            }
+            auto const victim = clock[hand];
+            victim->second.strongPtr.reset();
+            victim->second.index = weak.size();
+            weak.push_back(victim);
+            e.index = hand;
+            clock[hand] = entry;
+            hand = (hand + 1u) % clock.size();
+        }
+
+        void removeFromWeak(EntryPtr const entry) noexcept {
+            auto const index = entry->second.index;
+            assert(weak[index] == entry);
+            if (index != weak.size() - 1u) {
+                weak[index] = weak.back();
+                weak[index]->second.index = index;
+            }
+            weak.pop_back();
+        }
+
+        /** \brief Reclaims expired weakly referenced items incrementally. */
+        void sweep() noexcept {
+            for (std::size_t i = 0u; i < 2u && !weak.empty(); ++i) {
+                if (sweepPosition >= weak.size())
+                    sweepPosition = 0u;
+                auto const entry = weak[sweepPosition];
+                if (entry->second.weakPtr.expired()) {
+                    removeFromWeak(entry);
+                    entries.erase(entry->first);
+                } else {
+                    ++sweepPosition;
+                }
+            }
+        }
+
+    /* Fields: */
+
+        mutable SharedMutex mutex;
+        EntryMap entries;
+        std::vector<EntryPtr> clock;
+        std::vector<EntryPtr> weak;
+        std::size_t hand = 0u;
+        std::size_t sweepPosition = 0u;
+        std::size_t sizeLimit = 0u;
+
+    };
+
+public: /* Methods: */
+
+    /**
+      \param[in] limit The total number of items to keep alive.
+      \param[in] numShards The number of shards, rounded up to a power of two,
+                           but reduced to at most limit so that every shard can
+                           keep at least one item alive.
+    */
+    ConcurrentLRU(std::size_t const limit, std::size_t const numShards = 16u)
+        : m_shardMask(shardCount(limit, numShards) - 1u)
+        , m_shards(new Shard[m_shardMask + 1u])
+    {
+        assert(limit > 0u);
+        // Split the limit so that the shard limits add up to it exactly:
+        auto const numShards_ = m_shardMask + 1u;
+        auto const shardLimit = limit / numShards_;
+        auto const remainder = limit % numShards_;
+        for (std::size_t i = 0u; i < numShards_; ++i) {
+            auto & shard = m_shards[i];
+            shard.sizeLimit = shardLimit + (i < remainder ? 1u : 0u);
+            shard.clock.reserve(shard.sizeLimit);
+        }
+    }
+
+    ConcurrentLRU(ConcurrentLRU &&) = delete;
+    ConcurrentLRU(ConcurrentLRU const &) = delete;
+    ConcurrentLRU & operator=(ConcurrentLRU &&) = delete;
+    ConcurrentLRU & operator=(ConcurrentLRU const &) = delete;
+
+    /** \brief Inserts an item into the cache, replacing any old item. */
+    void insert(Key key, ValuePtr value) {
+        auto & shard = shardFor(key);
+        std::lock_guard<SharedMutex> const guard(shard.mutex);
+        // Make sure that a possible eviction in makeStrong() can not throw:
+        shard.weak.reserve(shard.weak.size() + 1u);
+        auto const r(shard.entries.emplace(std::move(key), value));
+        auto const entry = &*r.first;
+        if (r.second) {
+            shard.makeStrong(entry);
+        } else {
+            auto & e = entry->second;
+            bool const wasStrong = static_cast<bool>(e.strongPtr);
+            e.strongPtr = std::move(value);
+            e.weakPtr = e.strongPtr;
+            if (wasStrong) {
+                e.referenced.store(true, std::memory_order_relaxed);
+            } else {
+                shard.removeFromWeak(entry);
+                shard.makeStrong(entry);
+            }
+        }
+        shard.sweep();
+    }
+
+    /**
+      \returns the cached item for the given key, or nullptr if there is no
+               such item alive.
+    */
+    ValuePtr get(Key const & key) {
+        auto & shard = shardFor(key);
+        {
+            std::shared_lock<SharedMutex> const guard(shard.mutex);
+            auto const it(shard.entries.find(key));
+            if (it == shard.entries.end())
+                return nullptr;
+            auto & e = it->second;
+            if (e.strongPtr) {
+                if (!e.referenced.load(std::memory_order_relaxed))
+                    e.referenced.store(true, std::memory_order_relaxed);
+                return e.strongPtr;
+            }
+        }
+        // A weakly referenced item needs to be promoted or removed:
+        std::lock_guard<SharedMutex> const guard(shard.mutex);
+        auto const it(shard.entries.find(key));
+        if (it == shard.entries.end())
+            return nullptr;
+        auto & e = it->second;
+        if (e.strongPtr) { // Promoted concurrently
+            e.referenced.store(true, std::memory_order_relaxed);
+            return e.strongPtr;
+        }
+        auto const entry = &*it;
+        shard.removeFromWeak(entry);
+        if (ValuePtr ptr = e.weakPtr.lock()) {
+            e.strongPtr = ptr;
+            shard.makeStrong(entry);
+            shard.sweep();
+            return ptr;
+        }
+        shard.entries.erase(it);
+        return nullptr;
+    }
+
+    /** \brief Removes the item with the given key from the cache. */
+    void erase(Key const & key) {
+        auto & shard = shardFor(key);
+        std::lock_guard<SharedMutex> const guard(shard.mutex);
+        auto const it(shard.entries.find(key));
+        if (it == shard.entries.end())
+            return;
+        auto const entry = &*it;
+        if (it->second.strongPtr) {
+            /* Move the last entry of the ring into the hole, keeping the
+               clock hand within the ring: */
+            auto & clock = shard.clock;
+            auto const index = it->second.index;
+            if (index != clock.size() - 1u) {
+                clock[index] = clock.back();
+                clock[index]->second.index = index;
+            }
+            clock.pop_back();
+            if (shard.hand >= clock.size())
+                shard.hand = 0u;
+        } else {
+            shard.removeFromWeak(entry);
+        }
+        shard.entries.erase(it);
+    }
+
+    /** \brief Clears this cache. */
+    void clear() noexcept {
+        for (std::size_t i = 0u; i <= m_shardMask; ++i) {
+            auto & shard = m_shards[i];
+            std::lock_guard<SharedMutex> const guard(shard.mutex);
+            shard.clock.clear();
+            shard.weak.clear();
+            shard.entries.clear();
+            shard.hand = 0u;
+            shard.sweepPosition = 0u;
+        }
+    }
+
+    /**
+      \returns the number of items in the cache, including weakly referenced
+               ones which have expired but not yet been reclaimed.
+    */
+    std::size_t size() const noexcept {
+        std::size_t r = 0u;
+        for (std::size_t i = 0u; i <= m_shardMask; ++i) {
+            auto & shard = m_shards[i];
+            std::shared_lock<SharedMutex> const guard(shard.mutex);
+            r += shard.entries.size();
+        }
+        return r;
+    }
+
+    std::size_t numShards() const noexcept { return m_shardMask + 1u; }
+
+private: /* Methods: */
+
+    static std::size_t shardCount(std::size_t const limit,
+                                  std::size_t const numShards) noexcept
+    {
+        std::size_t r = 1u;
+        while (r < numShards && (r << 1u) <= limit)
+            r <<= 1u;
+        return r;
+    }
+
+    Shard & shardFor(Key const & key) const {
+        /* Use the high bits of a Fibonacci hash so that the shard does not
+           correlate with the bucket in the per-shard hash table: */
+        auto const h = static_cast<std::uint64_t>(Hash()(key))
+                       * UINT64_C(0x9e3779b97f4a7c15);
+        return m_shards[static_cast<std::size_t>(h >> 32u) & m_shardMask];
+    }
+
+private: /* Fields: */
+
+    std::size_t const m_shardMask;
+    std::unique_ptr<Shard[]> const m_shards;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_CONCURRENTLRU_H */
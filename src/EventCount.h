@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_EVENTCOUNT_H
+#define SHAREMIND_EVENTCOUNT_H
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <sharemind/AlignToCacheLine.h>
+#include "Futex.h"
+
+
+namespace sharemind {
+
+/**
+  \brief A condition variable for lock-free data structures.
+
+  A waiter first calls prepareWait(), then re-checks its condition, and then
+  either calls cancelWait() if the condition holds or wait() otherwise. A
+  notifier changes the state and then calls notifyOne() or notifyAll(), which
+  only cost a fence and a relaxed load if there are no waiters.
+*/
+class EventCount {
+
+public: /* Types: */
+
+    class Key {
+
+        friend class EventCount;
+
+    private: /* Methods: */
+
+        explicit Key(std::uint32_t const epoch) noexcept : m_epoch(epoch) {}
+
+    private: /* Fields: */
+
+        std::uint32_t m_epoch;
+
+    };
+
+public: /* Methods: */
+
+    EventCount() noexcept {}
+
+    EventCount(EventCount const &) = delete;
+    EventCount & operator=(EventCount const &) = delete;
+
+    Key prepareWait() noexcept {
+        m_waiters.fetch_add(1u, std::memory_order_relaxed);
+        // Pairs with the fence in hasWaiters():
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return Key(m_epoch.load(std::memory_order_acquire));
+    }
+
+    void cancelWait() noexcept {
+        assert(m_waiters.load(std::memory_order_relaxed) > 0u);
+        m_waiters.fetch_sub(1u, std::memory_order_relaxed);
+    }
+
+    void wait(Key const key) noexcept {
+        while (m_epoch.load(std::memory_order_acquire) == key.m_epoch)
+            futexWait(m_epoch, key.m_epoch);
+        cancelWait();
+    }
+
+    /** \returns false on timeout, true otherwise. */
+    template <typename Duration>
+    bool waitUntil(
+            Key const key,
+            std::chrono::time_point<std::chrono::steady_clock, Duration> const &
+                timePoint) noexcept
+    {
+        bool r = true;
+        while (m_epoch.load(std::memory_order_acquire) == key.m_epoch) {
+            if (!futexWaitUntil(m_epoch, key.m_epoch, timePoint)) {
+                r = (m_epoch.load(std::memory_order_acquire) != key.m_epoch);
+                break;
+            }
+        }
+        cancelWait();
+        return r;
+    }
+
+    /**
+      \brief Blocks until the given condition holds.
+      \param[in] condition The condition to test, re-tested after each wakeup.
+    */
+    template <typename Condition>
+    void await(Condition && condition)
+            noexcept(noexcept(static_cast<bool>(condition())))
+    {
+        while (!condition()) {
+            auto const key(prepareWait());
+            if (condition()) {
+                cancelWait();
+                return;
+            }
+            wait(key);
+        }
+    }
+
+    void notifyOne() noexcept {
+        if (hasWaiters()) {
+            m_epoch.fetch_add(1u, std::memory_order_seq_cst);
+            futexWakeOne(m_epoch);
+        }
+    }
+
+    void notifyAll() noexcept {
+        if (hasWaiters()) {
+            m_epoch.fetch_add(1u, std::memory_order_seq_cst);
+            futexWakeAll(m_epoch);
+        }
+    }
+
+private: /* Methods: */
+
+    bool hasWaiters() noexcept {
+        /* Pairs with prepareWait(), so that either the waiter observes the new
+           state or we observe the waiter: */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return m_waiters.load(std::memory_order_relaxed) != 0u;
+    }
+
+private: /* Fields: */
+
+    SHAREMIND_ALIGN_TO_CACHE_SIZE FutexWord m_epoch{0u};
+    std::atomic<std::uint32_t> m_waiters{0u};
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_EVENTCOUNT_H */
@@ -347,7 +347,10 @@ public: /* Methods: */
     }
 
     void spinUntilLoopIterationEnd() noexcept
-    { spinOnLoopIterationEnd_(&sharemind::spinWait); }
+    {
+        SpinWaiter waiter;
+        spinOnLoopIterationEnd_([&waiter]() noexcept { waiter.wait(); });
+    }
 
     void yieldUntilLoopIterationEnd() noexcept
     { spinOnLoopIterationEnd_(&std::this_thread::yield); }
@@ -0,0 +1,1393 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_FLATUNORDEREDMAP_H
+#define SHAREMIND_FLATUNORDEREDMAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Concepts.h"
+#include "HashTablePredicate.h"
+#include "RemoveCvref.h"
+#include "UnorderedMap.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace sharemind {
+namespace Detail {
+namespace FlatUnorderedMap {
+
+/*
+  Every slot of the table has a control byte. Full slots store the lowest 7
+  bits of the (mixed) hash of their element, free slots store one of the
+  negative values below. The control array has a trailing sentinel byte which
+  terminates iteration.
+*/
+using Ctrl = signed char;
+constexpr Ctrl const ctrlEmpty = -128;
+constexpr Ctrl const ctrlDeleted = -2;
+constexpr Ctrl const ctrlSentinel = -1;
+
+constexpr std::size_t const groupWidth = 16u;
+
+/** \brief A view of groupWidth control bytes matched in parallel. */
+class Group {
+
+public: /* Methods: */
+
+    #if defined(__SSE2__)
+    explicit Group(Ctrl const * const ctrl) noexcept
+        : m_ctrl(_mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl)))
+    {}
+
+    std::uint32_t match(Ctrl const h2) const noexcept
+    { return mask(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)); }
+
+    std::uint32_t matchEmpty() const noexcept
+    { return mask(_mm_cmpeq_epi8(_mm_set1_epi8(ctrlEmpty), m_ctrl)); }
+
+    std::uint32_t matchFree() const noexcept { return mask(m_ctrl); }
+
+private: /* Methods: */
+
+    static std::uint32_t mask(__m128i const v) noexcept
+    { return static_cast<std::uint32_t>(_mm_movemask_epi8(v)); }
+
+private: /* Fields: */
+
+    __m128i m_ctrl;
+    #else
+    explicit Group(Ctrl const * const ctrl) noexcept
+    { std::memcpy(m_ctrl, ctrl, groupWidth); }
+
+    std::uint32_t match(Ctrl const h2) const noexcept {
+        std::uint32_t r = 0u;
+        for (std::size_t i = 0u; i < groupWidth; ++i)
+            r |= static_cast<std::uint32_t>(m_ctrl[i] == h2) << i;
+        return r;
+    }
+
+    std::uint32_t matchEmpty() const noexcept { return match(ctrlEmpty); }
+
+    std::uint32_t matchFree() const noexcept {
+        std::uint32_t r = 0u;
+        for (std::size_t i = 0u; i < groupWidth; ++i)
+            r |= static_cast<std::uint32_t>(m_ctrl[i] < 0) << i;
+        return r;
+    }
+
+private: /* Fields: */
+
+    Ctrl m_ctrl[groupWidth];
+    #endif
+
+}; /* class Group { */
+
+inline std::size_t lowestBit(std::uint32_t const mask) noexcept
+{ return static_cast<std::size_t>(__builtin_ctz(mask)); }
+
+/** \brief Triangular probing over groups, visits every group once. */
+class ProbeSequence {
+
+public: /* Methods: */
+
+    ProbeSequence(std::size_t const group, std::size_t const groupMask)
+            noexcept
+        : m_group(group & groupMask)
+        , m_groupMask(groupMask)
+    {}
+
+    std::size_t offset() const noexcept { return m_group * groupWidth; }
+
+    void next() noexcept {
+        ++m_step;
+        m_group = (m_group + m_step) & m_groupMask;
+    }
+
+private: /* Fields: */
+
+    std::size_t m_group;
+    std::size_t const m_groupMask;
+    std::size_t m_step = 0u;
+
+}; /* class ProbeSequence { */
+
+/** \brief Spreads the user hash so that both of its halves carry entropy. */
+inline std::uint64_t mixHash(std::size_t const hash) noexcept
+{ return static_cast<std::uint64_t>(hash) * 0x9e3779b97f4a7c15u; }
+
+inline Ctrl h2(std::size_t const hash) noexcept
+{ return static_cast<Ctrl>(mixHash(hash) >> 57u); }
+
+inline std::size_t h1(std::size_t const hash) noexcept {
+    auto const mixed(mixHash(hash));
+    return static_cast<std::size_t>(mixed >> 32u)
+           ^ static_cast<std::size_t>(mixed);
+}
+
+/** \brief The control array of tables without storage, never written to. */
+inline Ctrl * emptyCtrl() noexcept {
+    static Ctrl sentinel = ctrlSentinel;
+    return &sentinel;
+}
+
+/**
+  \brief Storage for a single element and its hash.
+
+  Elements are stored as std::pair<Key, T>, so that their keys can be moved
+  from when the table is rehashed, and are exposed to users as
+  std::pair<Key const, T>, which has the same layout.
+*/
+template <typename Key, typename T>
+struct Slot {
+
+/* Types: */
+
+    using Value = std::pair<Key const, T>;
+    using MutableValue = std::pair<Key, T>;
+
+    static_assert(sizeof(Value) == sizeof(MutableValue)
+                  && alignof(Value) == alignof(MutableValue),
+                  "std::pair<Key const, T> and std::pair<Key, T> differ!");
+
+/* Methods: */
+
+    Value & value() noexcept
+    { return *reinterpret_cast<Value *>(&storage); }
+
+    Value const & value() const noexcept
+    { return *reinterpret_cast<Value const *>(&storage); }
+
+    MutableValue & mutableValue() noexcept
+    { return *reinterpret_cast<MutableValue *>(&storage); }
+
+    MutableValue const & mutableValue() const noexcept
+    { return *reinterpret_cast<MutableValue const *>(&storage); }
+
+/* Fields: */
+
+    std::size_t hash;
+    typename std::aligned_storage<sizeof(MutableValue),
+                                  alignof(MutableValue)>::type storage;
+
+};
+
+template <typename Key, typename ... Args>
+struct EmplacesByKey : std::false_type {};
+
+template <typename Key, typename K, typename V>
+struct EmplacesByKey<Key, K, V>
+        : std::is_same<RemoveCvrefT<K>, Key>
+{};
+
+} /* namespace FlatUnorderedMap { */
+} /* namespace Detail { */
+
+/**
+    \brief An open-addressing alternative to UnorderedMap with the same
+           explicit hash and predicate based lookup interface.
+
+    Elements are stored inline in a single slot array together with their
+    hashes, and are located by matching 16 control bytes at a time (with SSE2
+    where available). A lookup usually touches the control group and the slot
+    of the element only.
+
+    Unlike UnorderedMap, inserting elements or calling rehash() or reserve()
+    may move elements, invalidating all iterators, pointers and references.
+    Erasing invalidates only iterators, pointers and references to the erased
+    elements. A bucket corresponds to a single slot, and the bucket of a hash
+    is the slot from which probing for it starts. No local iterators are
+    provided.
+*/
+template <
+    typename Key,
+    typename T,
+    typename Hash_ = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Allocator = std::allocator<std::pair<const Key, T> >
+>
+class FlatUnorderedMap {
+
+public: /* Types: */
+
+    using key_type = Key;
+    using value_type = std::pair<Key const, T>;
+    using mapped_type = T;
+
+    using hasher = Hash_;
+    static_assert(Models<Hash(hasher, key_type)>::value,
+                  "Hash_ does not model Hash for key_type.");
+
+    using hash_type =
+            decltype(
+                    std::declval<hasher &>()(std::declval<key_type const &>()));
+    static_assert(std::is_convertible<hash_type, std::size_t>::value,
+                  "Hash_ must return values convertible to std::size_t!");
+
+    using key_equal =
+            typename Detail::UnorderedMap::ChooseKeyEqual<hasher,
+                                                          KeyEqual>::type;
+    using allocator_type = Allocator;
+    using pointer =
+            typename std::allocator_traits<allocator_type>::pointer;
+    using const_pointer =
+            typename std::allocator_traits<allocator_type>::const_pointer;
+    using reference = value_type &;
+    using const_reference = value_type const &;
+
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    static_assert(!Detail::UnorderedMap::HasTransparentKeyEqual<hasher>::value
+                  || Detail::UnorderedMap::HasIsTransparent<key_equal>::value,
+                  "Hash_::transparent_key_equal is not transparent!");
+
+    static_assert(!Detail::UnorderedMap::HasTransparentKeyEqual<hasher>::value
+                  || std::is_same<KeyEqual, std::equal_to<Key> >::value
+                  || std::is_same<KeyEqual, key_equal>::value,
+                  "Invalid KeyEqual provided!");
+
+private: /* Types: */
+
+    using Ctrl = Detail::FlatUnorderedMap::Ctrl;
+    using Group = Detail::FlatUnorderedMap::Group;
+    using ProbeSequence = Detail::FlatUnorderedMap::ProbeSequence;
+    using Slot = Detail::FlatUnorderedMap::Slot<Key, T>;
+
+    using AllocatorTraits = std::allocator_traits<allocator_type>;
+    using CtrlAllocator =
+            typename AllocatorTraits::template rebind_alloc<Ctrl>;
+    using SlotAllocator =
+            typename AllocatorTraits::template rebind_alloc<Slot>;
+
+    template <bool Const>
+    class IteratorBase {
+
+        friend class FlatUnorderedMap;
+        friend class IteratorBase<!Const>;
+
+    public: /* Types: */
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename FlatUnorderedMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer =
+                typename std::conditional<Const,
+                                          value_type const *,
+                                          value_type *>::type;
+        using reference =
+                typename std::conditional<Const,
+                                          value_type const &,
+                                          value_type &>::type;
+
+    public: /* Methods: */
+
+        IteratorBase() noexcept = default;
+
+        template <bool C = Const, typename std::enable_if<C, int>::type = 0>
+        IteratorBase(IteratorBase<false> const & copy) noexcept
+            : m_ctrl(copy.m_ctrl)
+            , m_slot(copy.m_slot)
+        {}
+
+        reference operator*() const noexcept { return m_slot->value(); }
+        pointer operator->() const noexcept { return &m_slot->value(); }
+
+        IteratorBase & operator++() noexcept {
+            ++m_ctrl;
+            ++m_slot;
+            skipFree();
+            return *this;
+        }
+
+        IteratorBase operator++(int) noexcept {
+            auto r(*this);
+            ++(*this);
+            return r;
+        }
+
+        friend bool operator==(IteratorBase const & lhs,
+                               IteratorBase const & rhs) noexcept
+        { return lhs.m_ctrl == rhs.m_ctrl; }
+
+        friend bool operator!=(IteratorBase const & lhs,
+                               IteratorBase const & rhs) noexcept
+        { return lhs.m_ctrl != rhs.m_ctrl; }
+
+    private: /* Methods: */
+
+        IteratorBase(Ctrl const * const ctrl, Slot * const slot) noexcept
+            : m_ctrl(ctrl)
+            , m_slot(slot)
+        {}
+
+        void skipFree() noexcept {
+            using Detail::FlatUnorderedMap::ctrlSentinel;
+            while (*m_ctrl < ctrlSentinel) {
+                ++m_ctrl;
+                ++m_slot;
+            }
+        }
+
+    private: /* Fields: */
+
+        Ctrl const * m_ctrl = nullptr;
+        Slot * m_slot = nullptr;
+
+    }; /* class IteratorBase { */
+
+public: /* Types: */
+
+    using iterator = IteratorBase<false>;
+    using const_iterator = IteratorBase<true>;
+
+public: /* Methods: */
+
+    /* Construct/copy/destroy: */
+
+    FlatUnorderedMap() = default;
+
+    explicit FlatUnorderedMap(size_type numBuckets,
+                              hasher const & hf = hasher(),
+                              key_equal const & eql = key_equal(),
+                              allocator_type const & a = allocator_type())
+        : m_hasher(hf)
+        , m_pred(eql)
+        , m_allocator(a)
+    { rehash(numBuckets); }
+
+    FlatUnorderedMap(size_type numBuckets,
+                     allocator_type const & alloc)
+        : FlatUnorderedMap(numBuckets, hasher(), key_equal(), alloc)
+    {}
+
+    FlatUnorderedMap(size_type numBuckets,
+                     hasher const & hf,
+                     allocator_type const & alloc)
+        : FlatUnorderedMap(numBuckets, hf, key_equal(), alloc)
+    {}
+
+    template <typename InputIterator>
+    FlatUnorderedMap(InputIterator first,
+                     InputIterator last,
+                     size_type numBuckets = 0u,
+                     hasher const & hf = hasher(),
+                     key_equal const & eql = key_equal(),
+                     allocator_type const & a = allocator_type())
+        : FlatUnorderedMap(numBuckets, hf, eql, a)
+    { insert(first, last); }
+
+    template <typename InputIterator>
+    FlatUnorderedMap(InputIterator first,
+                     InputIterator last,
+                     size_type numBuckets,
+                     allocator_type const & alloc)
+        : FlatUnorderedMap(std::move(first),
+                           std::move(last),
+                           numBuckets,
+                           hasher(),
+                           key_equal(),
+                           alloc)
+    {}
+
+    template <typename InputIterator>
+    FlatUnorderedMap(InputIterator first,
+                     InputIterator last,
+                     size_type numBuckets,
+                     hasher const & hf,
+                     allocator_type const & alloc)
+        : FlatUnorderedMap(std::move(first),
+                           std::move(last),
+                           numBuckets,
+                           hf,
+                           key_equal(),
+                           alloc)
+    {}
+
+    FlatUnorderedMap(std::initializer_list<value_type> values,
+                     size_type numBuckets = 0u,
+                     hasher const & hf = hasher(),
+                     key_equal const & eql = key_equal(),
+                     allocator_type const & a = allocator_type())
+        : FlatUnorderedMap(numBuckets, hf, eql, a)
+    { insert(values); }
+
+    FlatUnorderedMap(std::initializer_list<value_type> values,
+                     size_type numBuckets,
+                     allocator_type const & alloc)
+        : FlatUnorderedMap(std::move(values),
+                           numBuckets,
+                           hasher(),
+                           key_equal(),
+                           alloc)
+    {}
+
+    FlatUnorderedMap(std::initializer_list<value_type> values,
+                     size_type numBuckets,
+                     hasher const & hf,
+                     allocator_type const & alloc)
+        : FlatUnorderedMap(std::move(values),
+                           numBuckets,
+                           hf,
+                           key_equal(),
+                           alloc)
+    {}
+
+    FlatUnorderedMap(FlatUnorderedMap const & copy)
+        : FlatUnorderedMap(
+              copy,
+              AllocatorTraits::select_on_container_copy_construction(
+                  copy.m_allocator))
+    {}
+
+    FlatUnorderedMap(FlatUnorderedMap && move) noexcept
+        : m_hasher(std::move(move.m_hasher))
+        , m_pred(std::move(move.m_pred))
+        , m_allocator(std::move(move.m_allocator))
+        , m_maxLoadFactor(move.m_maxLoadFactor)
+    { steal(move); }
+
+    explicit FlatUnorderedMap(allocator_type const & allocator)
+        : m_allocator(allocator)
+    {}
+
+    FlatUnorderedMap(FlatUnorderedMap const & copy,
+                     allocator_type const & allocator)
+        : m_hasher(copy.m_hasher)
+        , m_pred(copy.m_pred)
+        , m_allocator(allocator)
+        , m_maxLoadFactor(copy.m_maxLoadFactor)
+    { transferFrom(copy); }
+
+    FlatUnorderedMap(FlatUnorderedMap && move,
+                     allocator_type const & allocator)
+        : m_hasher(std::move(move.m_hasher))
+        , m_pred(std::move(move.m_pred))
+        , m_allocator(allocator)
+        , m_maxLoadFactor(move.m_maxLoadFactor)
+    {
+        if (m_allocator == move.m_allocator) {
+            steal(move);
+        } else {
+            transferFrom(std::move(move));
+            move.clear();
+        }
+    }
+
+    ~FlatUnorderedMap() noexcept { destroyAndDeallocate(); }
+
+    FlatUnorderedMap & operator=(FlatUnorderedMap const & rhs) {
+        if (&rhs != this) {
+            destroyAndDeallocate();
+            m_hasher = rhs.m_hasher;
+            m_pred = rhs.m_pred;
+            m_maxLoadFactor = rhs.m_maxLoadFactor;
+            Detail::UnorderedMap::PropagateAllocator<
+                        AllocatorTraits
+                            ::propagate_on_container_copy_assignment::value
+                    >::copy(m_allocator, rhs.m_allocator);
+            transferFrom(rhs);
+        }
+        return *this;
+    }
+
+    FlatUnorderedMap & operator=(FlatUnorderedMap && rhs) {
+        if (&rhs != this) {
+            destroyAndDeallocate();
+            m_hasher = std::move(rhs.m_hasher);
+            m_pred = std::move(rhs.m_pred);
+            m_maxLoadFactor = rhs.m_maxLoadFactor;
+            constexpr bool const propagate =
+                    AllocatorTraits
+                        ::propagate_on_container_move_assignment::value;
+            if (propagate || (m_allocator == rhs.m_allocator)) {
+                Detail::UnorderedMap::PropagateAllocator<propagate>::move(
+                            m_allocator,
+                            std::move(rhs.m_allocator));
+                steal(rhs);
+            } else {
+                transferFrom(std::move(rhs));
+                rhs.clear();
+            }
+        }
+        return *this;
+    }
+
+    FlatUnorderedMap & operator=(std::initializer_list<value_type> values) {
+        clear();
+        insert(values);
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept { return m_allocator; }
+
+
+    /* Size and capacity: */
+
+    bool empty() const noexcept { return !m_size; }
+
+    size_type size() const noexcept { return m_size; }
+
+    size_type max_size() const noexcept {
+        SlotAllocator const slotAllocator(m_allocator);
+        return std::allocator_traits<SlotAllocator>::max_size(slotAllocator);
+    }
+
+
+    /* Iterators: */
+
+    iterator begin() noexcept {
+        iterator r(m_ctrl, m_slots);
+        r.skipFree();
+        return r;
+    }
+
+    const_iterator begin() const noexcept {
+        const_iterator r(m_ctrl, m_slots);
+        r.skipFree();
+        return r;
+    }
+
+    iterator end() noexcept { return iteratorAt(m_capacity); }
+
+    const_iterator end() const noexcept { return iteratorAt(m_capacity); }
+
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    const_iterator cend() const noexcept { return end(); }
+
+
+    /* Modifiers: */
+
+    template <typename ... Args>
+    std::pair<iterator, bool> emplace(Args && ... args) {
+        return emplace_(Detail::FlatUnorderedMap::EmplacesByKey<
+                                key_type,
+                                Args...>(),
+                        std::forward<Args>(args)...);
+    }
+
+    template <typename ... Args>
+    iterator emplace_hint(const_iterator /* hint */, Args && ... args)
+    { return emplace(std::forward<Args>(args)...).first; }
+
+    std::pair<iterator, bool> insert(value_type const & obj)
+    { return emplaceKey(m_hasher(obj.first), obj.first, obj.second); }
+
+    template <typename P,
+              SHAREMIND_REQUIRES_CONCEPTS(Constructible(value_type, P &&))>
+    std::pair<iterator, bool> insert(P && obj)
+    { return emplace(std::forward<P>(obj)); }
+
+    iterator insert(const_iterator hint, value_type const & obj)
+    { return emplace_hint(std::move(hint), obj); }
+
+    template <typename P,
+              SHAREMIND_REQUIRES_CONCEPTS(Constructible(value_type, P &&))>
+    iterator insert(const_iterator hint, P && obj)
+    { return emplace_hint(std::move(hint), std::forward<P>(obj)); }
+
+    template <typename InputIterator>
+    void insert(InputIterator first, InputIterator last) {
+        using V = typename std::iterator_traits<InputIterator>::value_type;
+        std::for_each(first, last, [this](V const & v) { insert(v); });
+    }
+
+    void insert(std::initializer_list<value_type> values)
+    { return insert(values.begin(), values.end()); }
+
+    template <typename Value>
+    std::pair<iterator, bool> insert_or_assign(key_type const & k, Value && v)
+    { return insertOrAssign(k, std::forward<Value>(v)); }
+
+    template <typename Value>
+    iterator insert_or_assign(const_iterator /* hint */,
+                              key_type const & k,
+                              Value && v)
+    { return insert_or_assign(k, std::forward<Value>(v)).first; }
+
+    template <typename Value>
+    std::pair<iterator, bool> insert_or_assign(key_type && k, Value && v)
+    { return insertOrAssign(std::move(k), std::forward<Value>(v)); }
+
+    template <typename Value>
+    iterator insert_or_assign(const_iterator /* hint */,
+                              key_type && k,
+                              Value && v)
+    { return insert_or_assign(std::move(k), std::forward<Value>(v)).first; }
+
+    iterator erase(const_iterator position) noexcept {
+        auto const i(indexOf(position));
+        eraseAt(i);
+        auto r(iteratorAt(i + 1u));
+        r.skipFree();
+        return r;
+    }
+
+    size_type erase(key_type const & k) {
+        auto const i(findIndex(m_hasher(k), keyMatcher(k)));
+        if (i == m_capacity)
+            return 0u;
+        eraseAt(i);
+        return 1u;
+    }
+
+    template <typename K>
+    auto erase(K const & key)
+            -> Detail::UnorderedMap::TransparentKeyEqualOverloadT<
+                    RemoveCvrefT<decltype(*this)>, K const &, size_type>
+    {
+        auto const i(transparentFindIndex(key));
+        if (i == m_capacity)
+            return 0u;
+        eraseAt(i);
+        return 1u;
+    }
+
+    iterator erase(const_iterator first, const_iterator last) noexcept {
+        auto const to(indexOf(last));
+        for (auto i(indexOf(first)); i < to; ++i)
+            if (m_ctrl[i] >= 0)
+                eraseAt(i);
+        return iteratorAt(to);
+    }
+
+    void clear() noexcept {
+        destroyElements();
+        resetCtrl();
+    }
+
+    void swap(FlatUnorderedMap & other) {
+        using std::swap;
+        swap(m_hasher, other.m_hasher);
+        swap(m_pred, other.m_pred);
+        swap(m_ctrl, other.m_ctrl);
+        swap(m_slots, other.m_slots);
+        swap(m_capacity, other.m_capacity);
+        swap(m_size, other.m_size);
+        swap(m_growthLeft, other.m_growthLeft);
+        swap(m_maxLoadFactor, other.m_maxLoadFactor);
+
+        Detail::UnorderedMap::PropagateAllocator<
+                    AllocatorTraits::propagate_on_container_swap::value
+                >::swap(m_allocator, other.m_allocator);
+    }
+
+
+    /* Observers: */
+
+    hasher hash_function() const
+        noexcept(noexcept(std::is_nothrow_copy_constructible<hasher>::value))
+    { return m_hasher; }
+
+    key_equal key_eq() const
+        noexcept(noexcept(std::is_nothrow_copy_constructible<key_equal>::value))
+    { return m_pred; }
+
+
+    /* Lookup: */
+
+    iterator find(key_type const & key)
+    { return iteratorAt(findIndex(m_hasher(key), keyMatcher(key))); }
+
+    const_iterator find(key_type const & key) const
+    { return iteratorAt(findIndex(m_hasher(key), keyMatcher(key))); }
+
+    /** \note Introduced to std::unordered_map in C++20. */
+    template <typename K>
+    auto find(K const & key)
+            -> Detail::UnorderedMap::TransparentKeyEqualOverloadT<
+                            RemoveCvrefT<decltype(*this)>,
+                            K const &,
+                            iterator>
+    { return iteratorAt(transparentFindIndex(key)); }
+
+    /** \note Introduced to std::unordered_map in C++20. */
+    template <typename K>
+    auto find(K const & key) const
+            -> Detail::UnorderedMap::TransparentKeyEqualOverloadT<
+                            RemoveCvrefT<decltype(*this)>,
+                            K const &,
+                            const_iterator>
+    { return iteratorAt(transparentFindIndex(key)); }
+
+    /** \note not in std::unordered_map */
+    template <typename Key_,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    Not(UnaryPredicate(Key_, key_type const &)))>
+    iterator find(hash_type hash, Key_ const & key)
+    { return iteratorAt(findIndex(std::move(hash), keyMatcher(key))); }
+
+    /** \note not in std::unordered_map */
+    template <typename Key_,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    Not(UnaryPredicate(Key_, key_type const &)))>
+    const_iterator find(hash_type hash, Key_ const & key) const
+    { return iteratorAt(findIndex(std::move(hash), keyMatcher(key))); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    UnaryPredicate(Pred, key_type const &))>
+    iterator find(hash_type hash, Pred && pred)
+    { return iteratorAt(findIndex(std::move(hash), pred)); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    UnaryPredicate(Pred, key_type const &))>
+    const_iterator find(hash_type hash, Pred && pred) const
+    { return iteratorAt(findIndex(std::move(hash), pred)); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(HashTablePredicate<Key>(Pred))>
+    iterator find(Pred && pred) {
+        std::size_t const hash(pred.hash());
+        return find(hash, std::forward<Pred>(pred));
+    }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(HashTablePredicate<Key>(Pred))>
+    const_iterator find(Pred && pred) const {
+        std::size_t const hash(pred.hash());
+        return find(hash, std::forward<Pred>(pred));
+    }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              typename Key_,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    BinaryPredicate(Pred, key_type const &, Key_ const &))>
+    iterator find(hash_type hash, Pred && pred, Key_ const & key) {
+        return iteratorAt(
+                    findIndex(std::move(hash),
+                              [&pred, &key](key_type const & k)
+                              { return pred(k, key); }));
+    }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              typename Key_,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    BinaryPredicate(Pred, key_type const &, Key_ const &))>
+    const_iterator find(hash_type hash, Pred && pred, Key_ const & key)
+            const
+    {
+        return iteratorAt(
+                    findIndex(std::move(hash),
+                              [&pred, &key](key_type const & k)
+                              { return pred(k, key); }));
+    }
+
+    /** \note Introduced to std::unordered_map in C++20. */
+    bool contains(key_type const & key) const { return find(key) != end(); }
+
+    /** \note Introduced to std::unordered_map in C++20. */
+    template <typename K>
+    auto contains(K const & key) const
+            -> Detail::UnorderedMap::TransparentKeyEqualOverloadT<
+                            RemoveCvrefT<decltype(*this)>,
+                            K const &,
+                            bool>
+    { return find(key) != end(); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    UnaryPredicate(Pred, key_type const &))>
+    bool contains(hash_type hash, Pred && pred) const
+    { return find(std::move(hash), std::forward<Pred>(pred)) != end(); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(HashTablePredicate<Key>(Pred))>
+    bool contains(Pred && pred) const {
+        std::size_t hash(pred.hash());
+        return contains(hash, std::forward<Pred>(pred));
+    }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              typename Key_,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    BinaryPredicate(Pred, key_type const &, Key_ const &))>
+    bool contains(hash_type hash, Pred && pred, Key_ const & key) const
+    { return find(std::move(hash), std::forward<Pred>(pred), key) != end(); }
+
+    size_type count(key_type const & key) const { return contains(key); }
+
+    /** \note Introduced to std::unordered_map in C++20. */
+    template <typename K>
+    auto count(K const & key) const
+            -> Detail::UnorderedMap::TransparentKeyEqualOverloadT<
+                            RemoveCvrefT<decltype(*this)>,
+                            K const &,
+                            std::size_t>
+    { return contains(key); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    UnaryPredicate(Pred, key_type const &))>
+    size_type count(hash_type hash, Pred && pred) const
+    { return contains(std::move(hash), std::forward<Pred>(pred)); }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              SHAREMIND_REQUIRES_CONCEPTS(HashTablePredicate<Key>(Pred))>
+    size_type count(Pred && pred) const {
+        std::size_t hash(pred.hash());
+        return count(hash, std::forward<Pred>(pred));
+    }
+
+    /** \note not in std::unordered_map */
+    template <typename Pred,
+              typename Key_,
+              SHAREMIND_REQUIRES_CONCEPTS(
+                    BinaryPredicate(Pred, key_type const &, Key_ const &))>
+    size_type count(hash_type hash, Pred && pred, Key_ const & key) const
+    { return contains(std::move(hash), std::forward<Pred>(pred), key); }
+
+    /** \note some not in std::unordered_map */
+    template <typename ... Args>
+    std::pair<iterator, iterator> equal_range(Args && ... args) {
+        std::pair<iterator, iterator> r(find(std::forward<Args>(args)...),
+                                        end());
+        if (r.first != r.second)
+            r.second = std::next(r.first);
+        return r;
+    }
+
+    /** \note some not in std::unordered_map */
+    template <typename ... Args>
+    std::pair<const_iterator, const_iterator> equal_range(Args && ... args)
+            const
+    {
+        std::pair<const_iterator, const_iterator> r(
+                    find(std::forward<Args>(args)...),
+                    end());
+        if (r.first != r.second)
+            r.second = std::next(r.first);
+        return r;
+    }
+
+    mapped_type & operator[](key_type const & key)
+    { return emplaceKey(m_hasher(key), key).first->second; }
+
+    mapped_type & operator[](key_type && key) {
+        auto const hash(m_hasher(key));
+        return emplaceKey(hash, std::move(key)).first->second;
+    }
+
+    mapped_type & at(key_type const & key) {
+        auto const i(findIndex(m_hasher(key), keyMatcher(key)));
+        if (i == m_capacity)
+            throw std::out_of_range("No such element in FlatUnorderedMap!");
+        return m_slots[i].value().second;
+    }
+
+    mapped_type const & at(key_type const & key) const {
+        auto const i(findIndex(m_hasher(key), keyMatcher(key)));
+        if (i == m_capacity)
+            throw std::out_of_range("No such element in FlatUnorderedMap!");
+        return m_slots[i].value().second;
+    }
+
+
+    /* Bucket interface: */
+
+    size_type bucket_count() const noexcept { return m_capacity; }
+
+    size_type max_bucket_count() const noexcept { return max_size(); }
+
+    size_type bucket(key_type const & key) const
+    { return hash_bucket(m_hasher(key)); }
+
+    /** \note not in std::unordered_map */
+    size_type hash_bucket(hash_type hash) const noexcept {
+        if (!m_capacity)
+            return 0u;
+        auto const h(static_cast<std::size_t>(hash));
+        return (Detail::FlatUnorderedMap::h1(h) & groupMask())
+               * Detail::FlatUnorderedMap::groupWidth;
+    }
+
+    /** \note not in std::unordered_map */
+    size_type bucket(const_iterator it) const noexcept
+    { return hash_bucket(static_cast<hash_type>(it.m_slot->hash)); }
+
+
+    /* Hash policy: */
+
+    float load_factor() const noexcept {
+        return m_capacity
+               ? static_cast<float>(m_size) / static_cast<float>(m_capacity)
+               : 0.0f;
+    }
+
+    float max_load_factor() const noexcept { return m_maxLoadFactor; }
+
+    /**
+      \brief Sets the maximum load factor, clamped to [0.25, 0.875] so that
+             probing always finds an empty slot.
+    */
+    void max_load_factor(float z) {
+        m_maxLoadFactor = std::min(std::max(z, 0.25f), 0.875f);
+        if (m_capacity && (m_size > growthLimit(m_capacity)))
+            rehashTo(capacityFor(m_size));
+        else if (m_capacity)
+            recomputeGrowthLeft();
+    }
+
+    void rehash(size_type n) {
+        if (!n && !m_size) {
+            destroyAndDeallocate();
+            return;
+        }
+        auto newCapacity(capacityFor(m_size));
+        while (newCapacity < n)
+            newCapacity *= 2u;
+        rehashTo(newCapacity);
+    }
+
+    void reserve(size_type n) {
+        if (n > m_size + m_growthLeft)
+            rehashTo(capacityFor(n));
+    }
+
+private: /* Methods: */
+
+    template <typename ... Args>
+    std::pair<iterator, bool> emplace_(std::true_type, Args && ... args)
+    { return emplaceKey_(std::forward<Args>(args)...); }
+
+    template <typename K, typename V>
+    std::pair<iterator, bool> emplaceKey_(K && key, V && value) {
+        auto const hash(m_hasher(key));
+        return emplaceKey(hash, std::forward<K>(key), std::forward<V>(value));
+    }
+
+    template <typename ... Args>
+    std::pair<iterator, bool> emplace_(std::false_type, Args && ... args) {
+        /* The key is needed for lookup, so construct the value beforehand and
+           relocate it into the table only if the key is not present: */
+        typename Slot::MutableValue value(std::forward<Args>(args)...);
+        auto const hash(m_hasher(value.first));
+        return emplaceKey(hash,
+                          std::move(value.first),
+                          std::move(value.second));
+    }
+
+    template <typename K, typename ... Args>
+    std::pair<iterator, bool> emplaceKey(std::size_t const hash,
+                                         K && key,
+                                         Args && ... args)
+    {
+        using R = std::pair<iterator, bool>;
+        auto const found(findIndex(hash, keyMatcher(key)));
+        if (found != m_capacity)
+            return R(iteratorAt(found), false);
+        auto const i(findInsertIndex(hash));
+        if (i != m_capacity) {
+            constructAt(i, hash, std::forward<K>(key),
+                        std::forward<Args>(args)...);
+            return R(iteratorAt(i), true);
+        }
+
+        /* The arguments might refer to elements of this table, hence the new
+           element is constructed in the new table before moving the others: */
+        auto newMap(emptyTable(capacityForInsert()));
+        auto const j(newMap.findFreeIndex(hash));
+        newMap.constructAt(j, hash, std::forward<K>(key),
+                           std::forward<Args>(args)...);
+        relocateAllTo(newMap);
+        return R(iteratorAt(j), true);
+    }
+
+    template <typename K, typename ... Args>
+    void constructAt(size_type const i,
+                     std::size_t const hash,
+                     K && key,
+                     Args && ... args)
+    {
+        AllocatorTraits::construct(
+                    m_allocator,
+                    &m_slots[i].mutableValue(),
+                    std::piecewise_construct,
+                    std::forward_as_tuple(std::forward<K>(key)),
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+        commitInsert(i, hash);
+    }
+
+    template <typename K, typename Value>
+    std::pair<iterator, bool> insertOrAssign(K && k, Value && v) {
+        using R = std::pair<iterator, bool>;
+        auto const hash(m_hasher(k));
+        auto const found(findIndex(hash, keyMatcher(k)));
+        if (found != m_capacity) {
+            m_slots[found].value().second = std::forward<Value>(v);
+            return R(iteratorAt(found), false);
+        }
+        return emplaceKey(hash, std::forward<K>(k), std::forward<Value>(v));
+    }
+
+    template <typename K>
+    auto keyMatcher(K const & key) const noexcept {
+        return [this, &key](key_type const & k)
+               { return m_pred(k, key); };
+    }
+
+    template <typename Pred>
+    size_type findIndex(hash_type const hash_, Pred && pred) const {
+        auto const hash(static_cast<std::size_t>(hash_));
+        if (!m_size)
+            return m_capacity;
+        auto const h2(Detail::FlatUnorderedMap::h2(hash));
+        for (ProbeSequence seq(Detail::FlatUnorderedMap::h1(hash),
+                               groupMask());;
+             seq.next())
+        {
+            auto const offset(seq.offset());
+            Group const group(m_ctrl + offset);
+            for (auto mask(group.match(h2)); mask; mask &= mask - 1u) {
+                auto const i(offset
+                             + Detail::FlatUnorderedMap::lowestBit(mask));
+                if ((m_slots[i].hash == hash) && pred(m_slots[i].value().first))
+                    return i;
+            }
+            if (group.matchEmpty())
+                return m_capacity;
+        }
+    }
+
+    template <typename K>
+    size_type transparentFindIndex(K const & key) const {
+        return transparentFindIndex(
+                    key,
+                    std::integral_constant<
+                        bool,
+                        Models<Hash(hasher, K const &)>::value>());
+    }
+
+    template <typename K>
+    size_type transparentFindIndex(K const & key, std::true_type) const
+    { return findIndex(m_hasher(key), keyMatcher(key)); }
+
+    template <typename K>
+    size_type transparentFindIndex(K const & key, std::false_type) const {
+        for (size_type i = 0u; i < m_capacity; ++i)
+            if ((m_ctrl[i] >= 0) && m_pred(m_slots[i].value().first, key))
+                return i;
+        return m_capacity;
+    }
+
+    size_type findFreeIndex(std::size_t const hash) const noexcept {
+        for (ProbeSequence seq(Detail::FlatUnorderedMap::h1(hash),
+                               groupMask());;
+             seq.next())
+        {
+            auto const offset(seq.offset());
+            if (auto const mask = Group(m_ctrl + offset).matchFree())
+                return offset + Detail::FlatUnorderedMap::lowestBit(mask);
+        }
+    }
+
+    /**
+      \returns the index of a free slot for an element with the given hash,
+               or m_capacity if the table needs to be rehashed beforehand.
+    */
+    size_type findInsertIndex(std::size_t const hash) const noexcept {
+        if (m_capacity) {
+            auto const i(findFreeIndex(hash));
+            if (m_growthLeft
+                || (m_ctrl[i] == Detail::FlatUnorderedMap::ctrlDeleted))
+                return i;
+        }
+        return m_capacity;
+    }
+
+    /** \returns the capacity to rehash to when the table has no room. */
+    size_type capacityForInsert() const noexcept {
+        if (!m_capacity)
+            return capacityFor(1u);
+        if (m_size < growthLimit(m_capacity) / 2u)
+            return m_capacity; // Drop tombstones only
+        return m_capacity * 2u;
+    }
+
+    void commitInsert(size_type const i, std::size_t const hash) noexcept {
+        if (m_ctrl[i] == Detail::FlatUnorderedMap::ctrlEmpty)
+            --m_growthLeft;
+        m_ctrl[i] = Detail::FlatUnorderedMap::h2(hash);
+        m_slots[i].hash = hash;
+        ++m_size;
+    }
+
+    void eraseAt(size_type const i) noexcept {
+        using namespace Detail::FlatUnorderedMap;
+        AllocatorTraits::destroy(m_allocator, &m_slots[i].mutableValue());
+        --m_size;
+        /* If the group already has an empty slot, no probe sequence continues
+           past it, hence the slot can be marked empty instead of deleted: */
+        if (Group(m_ctrl + (i & ~(groupWidth - 1u))).matchEmpty()) {
+            m_ctrl[i] = ctrlEmpty;
+            ++m_growthLeft;
+        } else {
+            m_ctrl[i] = ctrlDeleted;
+        }
+    }
+
+    /** \brief Moves all elements into a new table of the given capacity. */
+    void rehashTo(size_type const newCapacity) {
+        auto newMap(emptyTable(newCapacity));
+        relocateAllTo(newMap);
+    }
+
+    /** \returns an empty table of the given capacity like this one. */
+    FlatUnorderedMap emptyTable(size_type const capacity) const {
+        FlatUnorderedMap r(0u, m_hasher, m_pred, m_allocator);
+        r.m_maxLoadFactor = m_maxLoadFactor;
+        r.allocate(capacity);
+        return r;
+    }
+
+    /**
+      \brief Moves all elements into the given table, which then replaces the
+             storage of this table.
+      \note Elements are copied instead if they can not be moved without
+            throwing, leaving this table intact on failure.
+    */
+    void relocateAllTo(FlatUnorderedMap & newMap) {
+        constexpr bool const move =
+                (std::is_nothrow_move_constructible<key_type>::value
+                 && std::is_nothrow_move_constructible<mapped_type>::value)
+                || !std::is_copy_constructible<value_type>::value;
+
+        for (size_type i = 0u; i < m_capacity; ++i) {
+            if (m_ctrl[i] < 0)
+                continue;
+            auto & slot = m_slots[i];
+            auto const j(newMap.findFreeIndex(slot.hash));
+            relocate(newMap.m_slots[j],
+                     slot,
+                     std::integral_constant<bool, move>());
+            newMap.commitInsert(j, slot.hash);
+        }
+        destroyAndDeallocate();
+        steal(newMap);
+    }
+
+    void relocate(Slot & to, Slot & from, std::true_type) {
+        AllocatorTraits::construct(m_allocator,
+                                   &to.mutableValue(),
+                                   std::move(from.mutableValue()));
+    }
+
+    void relocate(Slot & to, Slot const & from, std::false_type) {
+        AllocatorTraits::construct(m_allocator,
+                                   &to.mutableValue(),
+                                   from.mutableValue());
+    }
+
+    /** \brief Inserts all elements of other into this empty map. */
+    template <typename Other>
+    void transferFrom(Other && other) {
+        if (!other.m_size)
+            return;
+        allocate(capacityFor(other.m_size));
+        try {
+            for (size_type i = 0u; i < other.m_capacity; ++i) {
+                if (other.m_ctrl[i] < 0)
+                    continue;
+                auto & slot = other.m_slots[i];
+                auto const j(findFreeIndex(slot.hash));
+                relocate(m_slots[j],
+                         slot,
+                         std::integral_constant<
+                                bool,
+                                std::is_rvalue_reference<Other &&>::value>());
+                commitInsert(j, slot.hash);
+            }
+        } catch (...) {
+            destroyAndDeallocate();
+            throw;
+        }
+    }
+
+    void allocate(size_type const capacity) {
+        assert(!m_capacity);
+        CtrlAllocator ctrlAllocator(m_allocator);
+        SlotAllocator slotAllocator(m_allocator);
+        auto * const ctrl =
+                std::allocator_traits<CtrlAllocator>::allocate(ctrlAllocator,
+                                                               capacity + 1u);
+        try {
+            m_slots =
+                std::allocator_traits<SlotAllocator>::allocate(slotAllocator,
+                                                               capacity);
+        } catch (...) {
+            std::allocator_traits<CtrlAllocator>::deallocate(ctrlAllocator,
+                                                             ctrl,
+                                                             capacity + 1u);
+            throw;
+        }
+        m_ctrl = ctrl;
+        m_capacity = capacity;
+        resetCtrl();
+    }
+
+    void resetCtrl() noexcept {
+        using namespace Detail::FlatUnorderedMap;
+        m_size = 0u;
+        if (!m_capacity)
+            return;
+        std::memset(m_ctrl,
+                    static_cast<unsigned char>(ctrlEmpty),
+                    m_capacity);
+        m_ctrl[m_capacity] = ctrlSentinel;
+        recomputeGrowthLeft();
+    }
+
+    void recomputeGrowthLeft() noexcept {
+        size_type used = 0u;
+        for (size_type i = 0u; i < m_capacity; ++i)
+            used += (m_ctrl[i] != Detail::FlatUnorderedMap::ctrlEmpty);
+        auto const limit(growthLimit(m_capacity));
+        m_growthLeft = (limit > used) ? (limit - used) : 0u;
+    }
+
+    void destroyElements() noexcept {
+        if (!m_size)
+            return;
+        for (size_type i = 0u; i < m_capacity; ++i)
+            if (m_ctrl[i] >= 0)
+                AllocatorTraits::destroy(m_allocator,
+                                         &m_slots[i].mutableValue());
+    }
+
+    void destroyAndDeallocate() noexcept {
+        if (!m_capacity)
+            return;
+        destroyElements();
+        CtrlAllocator ctrlAllocator(m_allocator);
+        SlotAllocator slotAllocator(m_allocator);
+        std::allocator_traits<CtrlAllocator>::deallocate(
+                    ctrlAllocator,
+                    m_ctrl,
+                    m_capacity + 1u);
+        std::allocator_traits<SlotAllocator>::deallocate(slotAllocator,
+                                                         m_slots,
+                                                         m_capacity);
+        m_ctrl = Detail::FlatUnorderedMap::emptyCtrl();
+        m_slots = nullptr;
+        m_capacity = 0u;
+        m_size = 0u;
+        m_growthLeft = 0u;
+    }
+
+    /** \pre This map holds no storage. */
+    void steal(FlatUnorderedMap & other) noexcept {
+        m_ctrl = other.m_ctrl;
+        m_slots = other.m_slots;
+        m_capacity = other.m_capacity;
+        m_size = other.m_size;
+        m_growthLeft = other.m_growthLeft;
+        other.m_ctrl = Detail::FlatUnorderedMap::emptyCtrl();
+        other.m_slots = nullptr;
+        other.m_capacity = 0u;
+        other.m_size = 0u;
+        other.m_growthLeft = 0u;
+    }
+
+    size_type growthLimit(size_type const capacity) const noexcept {
+        return static_cast<size_type>(static_cast<double>(capacity)
+                                      * m_maxLoadFactor);
+    }
+
+    size_type capacityFor(size_type const numElements) const noexcept {
+        auto capacity(Detail::FlatUnorderedMap::groupWidth);
+        while (growthLimit(capacity) < numElements)
+            capacity *= 2u;
+        return capacity;
+    }
+
+    size_type groupMask() const noexcept
+    { return (m_capacity / Detail::FlatUnorderedMap::groupWidth) - 1u; }
+
+    size_type indexOf(const_iterator it) const noexcept
+    { return static_cast<size_type>(it.m_ctrl - m_ctrl); }
+
+    iterator iteratorAt(size_type const i) noexcept
+    { return iterator(m_ctrl + i, m_slots + i); }
+
+    const_iterator iteratorAt(size_type const i) const noexcept
+    { return const_iterator(m_ctrl + i, m_slots + i); }
+
+private: /* Fields: */
+
+    hasher m_hasher;
+    key_equal m_pred;
+    allocator_type m_allocator;
+    Ctrl * m_ctrl = Detail::FlatUnorderedMap::emptyCtrl();
+    Slot * m_slots = nullptr;
+    size_type m_capacity = 0u;
+    size_type m_size = 0u;
+    size_type m_growthLeft = 0u;
+    float m_maxLoadFactor = 0.875f;
+
+}; /* class FlatUnorderedMap { */
+
+template <typename Key, typename T, typename Hash, typename Pred, typename A>
+bool operator==(FlatUnorderedMap<Key, T, Hash, Pred, A> const & lhs,
+                FlatUnorderedMap<Key, T, Hash, Pred, A> const & rhs)
+{
+    if (lhs.size() != rhs.size())
+        return false;
+    for (auto const & v : lhs) {
+        auto const it(rhs.find(v.first));
+        if ((it == rhs.end()) || !(it->second == v.second))
+            return false;
+    }
+    return true;
+}
+
+template <typename Key, typename T, typename Hash, typename Pred, typename A>
+bool operator!=(FlatUnorderedMap<Key, T, Hash, Pred, A> const & lhs,
+                FlatUnorderedMap<Key, T, Hash, Pred, A> const & rhs)
+{ return !(lhs == rhs); }
+
+} /* namespace Sharemind { */
+
+#endif /* SHAREMIND_FLATUNORDEREDMAP_H */
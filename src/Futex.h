@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_FUTEX_H
+#define SHAREMIND_FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#endif
+
+
+namespace sharemind {
+
+/**
+  \brief A 32-bit word which threads can block on until it is changed.
+
+  On Linux, waiting and waking are implemented using private futexes. On other
+  platforms a small static table of mutexes and condition variables, indexed
+  by the address of the word, is used instead.
+*/
+using FutexWord = std::atomic<std::uint32_t>;
+
+#if defined(__linux__)
+namespace Detail {
+namespace Futex {
+
+static_assert(sizeof(FutexWord) == sizeof(std::uint32_t), "");
+
+inline std::uint32_t * address(FutexWord & word) noexcept
+{ return reinterpret_cast<std::uint32_t *>(&word); }
+
+inline long futex(FutexWord & word,
+                  int const op,
+                  std::uint32_t const val,
+                  struct ::timespec const * const timeout = nullptr,
+                  std::uint32_t const val3 = 0u) noexcept
+{ return ::syscall(SYS_futex, address(word), op, val, timeout, nullptr, val3); }
+
+} /* namespace Futex { */
+} /* namespace Detail { */
+
+/**
+  \brief Blocks the calling thread while the given word equals the given
+         expected value, until woken by futexWakeOne() or futexWakeAll().
+  \note Spurious wakeups are possible.
+*/
+inline void futexWait(FutexWord & word, std::uint32_t const expected) noexcept
+{ Detail::Futex::futex(word, FUTEX_WAIT_PRIVATE, expected); }
+
+/**
+  \brief Like futexWait(), but with a timeout.
+  \returns false if the timeout expired, true otherwise.
+*/
+template <typename Duration>
+inline bool futexWaitUntil(
+        FutexWord & word,
+        std::uint32_t const expected,
+        std::chrono::time_point<std::chrono::steady_clock, Duration> const &
+            timePoint) noexcept
+{
+    /* std::chrono::steady_clock is based on CLOCK_MONOTONIC, which is also
+       what FUTEX_WAIT_BITSET uses for absolute timeouts: */
+    using namespace std::chrono;
+    auto const sinceEpoch(timePoint.time_since_epoch());
+    auto const secs(duration_cast<seconds>(sinceEpoch));
+    struct ::timespec ts;
+    if (secs.count() < 0) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = 0;
+    } else {
+        ts.tv_sec = static_cast<decltype(ts.tv_sec)>(secs.count());
+        ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(
+                        duration_cast<nanoseconds>(sinceEpoch - secs).count());
+    }
+    if (Detail::Futex::futex(word,
+                             FUTEX_WAIT_BITSET_PRIVATE,
+                             expected,
+                             &ts,
+                             FUTEX_BITSET_MATCH_ANY) == 0)
+        return true;
+    return errno != ETIMEDOUT;
+}
+
+/** \brief Wakes one thread blocked on the given word. */
+inline void futexWakeOne(FutexWord & word) noexcept
+{ Detail::Futex::futex(word, FUTEX_WAKE_PRIVATE, 1u); }
+
+/** \brief Wakes all threads blocked on the given word. */
+inline void futexWakeAll(FutexWord & word) noexcept
+{ Detail::Futex::futex(word, FUTEX_WAKE_PRIVATE, INT32_MAX); }
+
+#else
+namespace Detail {
+namespace Futex {
+
+struct Bucket {
+    std::mutex mutex;
+    std::condition_variable cond;
+};
+
+inline Bucket & bucket(FutexWord & word) noexcept {
+    static Bucket buckets[64u];
+    auto const a = reinterpret_cast<std::uintptr_t>(&word);
+    return buckets[(a >> 4u) % (sizeof(buckets) / sizeof(Bucket))];
+}
+
+} /* namespace Futex { */
+} /* namespace Detail { */
+
+inline void futexWait(FutexWord & word, std::uint32_t const expected) noexcept
+{
+    auto & b = Detail::Futex::bucket(word);
+    std::unique_lock<std::mutex> lock(b.mutex);
+    if (word.load(std::memory_order_relaxed) == expected)
+        b.cond.wait(lock);
+}
+
+template <typename Duration>
+inline bool futexWaitUntil(
+        FutexWord & word,
+        std::uint32_t const expected,
+        std::chrono::time_point<std::chrono::steady_clock, Duration> const &
+            timePoint) noexcept
+{
+    auto & b = Detail::Futex::bucket(word);
+    std::unique_lock<std::mutex> lock(b.mutex);
+    if (word.load(std::memory_order_relaxed) != expected)
+        return true;
+    return b.cond.wait_until(lock, timePoint) == std::cv_status::no_timeout;
+}
+
+inline void futexWakeOne(FutexWord & word) noexcept {
+    // The bucket might be shared by other words, hence wake everybody:
+    auto & b = Detail::Futex::bucket(word);
+    std::lock_guard<std::mutex> const guard(b.mutex);
+    b.cond.notify_all();
+}
+
+inline void futexWakeAll(FutexWord & word) noexcept {
+    auto & b = Detail::Futex::bucket(word);
+    std::lock_guard<std::mutex> const guard(b.mutex);
+    b.cond.notify_all();
+}
+#endif
+
+/**
+  \brief Like futexWait(), but with a relative timeout.
+  \returns false if the timeout expired, true otherwise.
+*/
+template <typename Rep, typename Period>
+inline bool futexWaitFor(FutexWord & word,
+                         std::uint32_t const expected,
+                         std::chrono::duration<Rep, Period> const & duration)
+        noexcept
+{
+    return futexWaitUntil(word,
+                          expected,
+                          std::chrono::steady_clock::now() + duration);
+}
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_FUTEX_H */
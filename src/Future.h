@@ -20,9 +20,11 @@
 #ifndef SHAREMIND_FUTURE_H
 #define SHAREMIND_FUTURE_H
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -30,7 +32,15 @@
 #include <new>
 #include <type_traits>
 #include <utility>
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define SHAREMIND_FUTURE_HAVE_COROUTINES 1
+#endif
+#endif
 #include "detail/ExceptionMacros.h"
+#include "CancellationToken.h"
+#include "Detected.h"
 #include "Exception.h"
 #include "StripReferenceWrapper.h"
 
@@ -38,6 +48,7 @@
 namespace sharemind {
 
 template <typename T> class Future;
+template <typename T> class SharedFuture;
 
 SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
                                             BrokenPromiseException,
@@ -46,26 +57,68 @@ SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
 namespace Detail {
 namespace Future {
 
-struct ContinuationBase { \
+template <typename T, typename Executor> class Awaiter;
+
+struct ContinuationBase {
+
+/* Types: */
+
+    struct Deleter {
+        Deleter() noexcept {}
+
+        template <typename T>
+        Deleter(std::default_delete<T> const &) noexcept {}
+
+        void operator()(ContinuationBase * const c) const noexcept
+        { c->dispose(); }
+    };
+
+/* Methods: */
+
     virtual ~ContinuationBase() noexcept {}
+
     virtual void run() noexcept = 0;
+
+    /** \brief Releases the continuation without running it. */
+    virtual void dispose() noexcept { delete this; }
+
+    /**
+      \brief Runs and releases the continuation.
+      \note Continuations which might be destroyed by run() itself must
+            override this not to access *this after run().
+    */
+    virtual void runAndDispose() noexcept {
+        run();
+        dispose();
+    }
+
+/* Fields: */
+
+    /** Link for the intrusive list of continuations of shared futures. */
+    ContinuationBase * m_next = nullptr;
+
 };
 
+using ContinuationPtr =
+        std::unique_ptr<ContinuationBase, ContinuationBase::Deleter>;
+
+inline void runContinuation(ContinuationPtr continuation) noexcept
+{ continuation.release()->runAndDispose(); }
+
 #define SHAREMIND_SHAREDSTATE_COMMON \
     /* Types: */ \
-    using ContinuationPtr = std::unique_ptr<Detail::Future::ContinuationBase>; \
+    using ContinuationPtr = Detail::Future::ContinuationPtr; \
     /* Methods: */ \
     void setException(std::exception_ptr e) noexcept { \
-        if (auto const continuation = \
+        runContinuations( \
                 [this](std::exception_ptr e_) noexcept -> ContinuationPtr {\
                     std::lock_guard<std::mutex> const guard(mutex); \
                     assert(!isSet); \
                     exception = std::move(e_); \
                     isSet = true; \
-                    cond.notify_one(); \
+                    cond.notify_all(); \
                     return std::move(m_continuation); \
-                }(std::move(e))) \
-            continuation->run(); \
+                }(std::move(e))); \
     } \
     bool ready() noexcept { \
         std::lock_guard<std::mutex> const guard(mutex); \
@@ -98,22 +151,71 @@ struct ContinuationBase { \
                                [this]() noexcept { return isSet; }); \
     } \
     void then(ContinuationPtr continuation) noexcept { \
-        if (auto const cont = \
-                [this](ContinuationPtr c) noexcept -> ContinuationPtr { \
-                    std::lock_guard<std::mutex> const guard(mutex); \
-                    assert(!m_continuation); \
-                    if (isSet) \
-                        return c; \
-                    m_continuation = std::move(c); \
-                    return nullptr; \
-                }(std::move(continuation))) \
-            cont->run(); \
+        if (!tryThen(continuation)) \
+            runContinuation(std::move(continuation)); \
+    } \
+    /* Attaches the continuation unless the state is already set, in which \
+       case the given continuation is left untouched and false is returned: */ \
+    bool tryThen(ContinuationPtr & continuation) noexcept { \
+        std::lock_guard<std::mutex> const guard(mutex); \
+        assert(!m_continuation); \
+        if (isSet) \
+            return false; \
+        m_continuation = std::move(continuation); \
+        return true; \
+    } \
+    /* Attaches a continuation of a shared future (lock-free). If the state \
+       is already set, the continuation is run immediately instead: */ \
+    void thenShared(ContinuationPtr continuation) noexcept { \
+        assert(continuation); \
+        auto head = m_sharedContinuations.load(std::memory_order_acquire); \
+        do { \
+            if (head == closedSharedContinuations()) \
+                return runContinuation(std::move(continuation)); \
+            continuation->m_next = head; \
+        } while (!m_sharedContinuations.compare_exchange_weak( \
+                        head, \
+                        continuation.get(), \
+                        std::memory_order_release, \
+                        std::memory_order_acquire)); \
+        continuation.release(); \
+    } \
+    /* Runs the given continuation (if any) followed by all continuations of \
+       shared futures in the order they were attached: */ \
+    void runContinuations(ContinuationPtr continuation) noexcept { \
+        if (continuation) \
+            runContinuation(std::move(continuation)); \
+        auto * c = m_sharedContinuations.exchange( \
+                            closedSharedContinuations(), \
+                            std::memory_order_acq_rel); \
+        assert(c != closedSharedContinuations()); \
+        Detail::Future::ContinuationBase * reversed = nullptr; \
+        while (c) { \
+            auto * const next = c->m_next; \
+            c->m_next = reversed; \
+            reversed = c; \
+            c = next; \
+        } \
+        while (reversed) { \
+            auto * const next = reversed->m_next; \
+            reversed->runAndDispose(); \
+            reversed = next; \
+        } \
+    } \
+    static Detail::Future::ContinuationBase * closedSharedContinuations() \
+            noexcept \
+    { \
+        return reinterpret_cast<Detail::Future::ContinuationBase *>( \
+                    static_cast<std::uintptr_t>(1u)); \
     } \
     /* Fields: */ \
     std::mutex mutex; \
     std::condition_variable cond; \
     std::exception_ptr exception; \
     ContinuationPtr m_continuation; \
+    std::atomic<Detail::Future::ContinuationBase *> m_sharedContinuations{ \
+            nullptr}; \
+    CancellationToken m_cancellationToken; \
     bool isSet = false;
 
 template <typename T>
@@ -125,20 +227,24 @@ struct SharedState {
 
 /* Methods: */
 
+    ~SharedState() noexcept {
+        if (isSet && !exception)
+            reinterpret_cast<T *>(&m_data)->~T();
+    }
+
     template <typename ... Args>
     void emplaceValue(Args && ... args)
             noexcept(noexcept(T(std::forward<Args>(args)...)))
     {
-        if (auto const continuation =
+        runContinuations(
                 [this](Args && ... args_) noexcept -> ContinuationPtr {
                     std::lock_guard<std::mutex> const guard(mutex);
                     assert(!isSet);
                     new(std::addressof(m_data)) T(std::forward<Args>(args_)...);
                     isSet = true;
-                    cond.notify_one();
+                    cond.notify_all();
                     return std::move(m_continuation);
-                }(std::forward<Args>(args)...))
-            continuation->run();
+                }(std::forward<Args>(args)...));
     }
 
     T takeValue() {
@@ -148,6 +254,13 @@ struct SharedState {
         return std::move(*reinterpret_cast<T *>(&m_data));
     }
 
+    T const & sharedValue() {
+        auto const lock(waitReadyLock());
+        if (exception)
+            std::rethrow_exception(exception);
+        return *reinterpret_cast<T const *>(&m_data);
+    }
+
 /* Fields: */
 
     typename std::aligned_storage<sizeof(T), alignof(T)>::type m_data;
@@ -162,15 +275,14 @@ struct SharedState<void> {
 /* Methods: */
 
     void setReady() noexcept {
-        if (auto const continuation =
+        runContinuations(
                 [this]() noexcept -> ContinuationPtr {
                     std::lock_guard<std::mutex> const guard(mutex);
                     assert(!isSet);
                     isSet = true;
-                    cond.notify_one();
+                    cond.notify_all();
                     return std::move(m_continuation);
-                }())
-            continuation->run();
+                }());
     }
 
     void takeValue() {
@@ -179,6 +291,8 @@ struct SharedState<void> {
             std::rethrow_exception(exception);
     }
 
+    void sharedValue() { return takeValue(); }
+
 };
 
 #undef SHAREMIND_SHAREDSTATE_COMMON
@@ -259,6 +373,20 @@ struct ContinuationRun<void> {
     }
 };
 
+/**
+  \brief A shared state which additionally embeds the storage for the
+         continuation which fulfills it, to avoid separate allocations for the
+         two.
+*/
+template <typename T, typename C>
+struct ContinuationHostState final: SharedState<T> {
+
+/* Fields: */
+
+    typename std::aligned_storage<sizeof(C), alignof(C)>::type m_storage;
+
+};
+
 template <template <typename> class Prom,
           typename Fut,
           typename F>
@@ -267,30 +395,131 @@ struct Continuation final: ContinuationBase {
 /* Types: */
 
     using Fun = typename std::decay<F>::type;
+    using Result = UnwrappedReturnType<F, Fut>;
+    using Ptr = std::unique_ptr<Continuation, ContinuationBase::Deleter>;
 
 /* Methods: */
 
+    /**
+      \brief Creates a continuation in the shared state of the future of the
+             result of the continuation, using a single allocation.
+    */
     template <typename ... Args>
-    explicit Continuation(Fut && future, Args && ... args)
-        : m_function(std::forward<Args>(args)...)
-        , m_future(std::move(future))
-    {}
+    static Ptr create(Fut && future, Args && ... args) {
+        auto host(std::make_shared<ContinuationHostState<Result,
+                                                         Continuation> >());
+        host->m_cancellationToken = future.cancellationToken();
+        void * const storage = std::addressof(host->m_storage);
+        return Ptr(new (storage) Continuation(std::move(host),
+                                              std::move(future),
+                                              std::forward<Args>(args)...));
+    }
 
     void run() noexcept final override {
+        if (m_keepAlive->m_cancellationToken.isCancelled()) {
+            static_cast<void>(Fut(std::move(m_future))); // Release input
+            return m_promise.setException(CancelledException());
+        }
         return ContinuationRun<PotentiallyWrappedReturnType<Fun, Fut> >::run(
                     m_promise,
                     m_function,
                     std::move(m_future));
     }
 
+    void dispose() noexcept final override {
+        // Keep the host state alive until we have been destroyed:
+        auto const keepAlive(std::move(m_keepAlive));
+        this->~Continuation();
+    }
+
+private: /* Methods: */
+
+    template <typename ... Args>
+    Continuation(std::shared_ptr<SharedState<Result> > host,
+                 Fut && future,
+                 Args && ... args)
+        : m_keepAlive(host)
+        , m_function(std::forward<Args>(args)...)
+        , m_promise(std::move(host))
+        , m_future(std::move(future))
+    {}
+
+    ~Continuation() noexcept override {}
+
 /* Fields: */
 
+    std::shared_ptr<SharedState<Result> > m_keepAlive;
+
+public: /* Fields: */
+
     Fun m_function;
-    Prom<UnwrappedReturnType<F, Fut> > m_promise;
+    Prom<Result> m_promise;
     Fut m_future;
 
 };
 
+template <typename Executor>
+using ExecutorRunningInThisThread =
+        decltype(std::declval<Executor const &>().runningInThisThread());
+
+template <typename Executor>
+inline bool runningInExecutor(Executor const & executor, std::true_type)
+        noexcept
+{ return executor.runningInThisThread(); }
+
+template <typename Executor>
+inline bool runningInExecutor(Executor const &, std::false_type) noexcept
+{ return false; }
+
+/**
+  \brief Continuation wrapper which runs the wrapped continuation through the
+         given executor.
+
+  An executor is any object providing an execute(f) member function which
+  schedules the given nullary noexcept function object for execution. If the
+  executor additionally provides a runningInThisThread() const noexcept member
+  function which returns true, the wrapped continuation is run directly instead
+  of being rescheduled. If scheduling fails with an exception, the wrapped
+  continuation is also run directly.
+*/
+template <typename Executor>
+struct ExecutorContinuation final: ContinuationBase {
+
+/* Types: */
+
+    struct Task {
+        void operator()() noexcept
+        { return runContinuation(std::move(m_continuation)); }
+        ContinuationPtr m_continuation;
+    };
+
+/* Methods: */
+
+    explicit ExecutorContinuation(Executor & executor) noexcept
+        : m_executor(executor)
+    {}
+
+    void run() noexcept final override {
+        assert(m_continuation);
+        if (runningInExecutor(
+                m_executor,
+                IsDetected<ExecutorRunningInThisThread, Executor>()))
+            return runContinuation(std::move(m_continuation));
+        Task task{std::move(m_continuation)};
+        try {
+            return m_executor.execute(std::move(task));
+        } catch (...) {}
+        if (task.m_continuation)
+            runContinuation(std::move(task.m_continuation));
+    }
+
+/* Fields: */
+
+    Executor & m_executor;
+    ContinuationPtr m_continuation;
+
+};
+
 } /* namespace Future { */
 } /* namespace Detail { */
 
@@ -299,6 +528,8 @@ template <typename T> class Promise;
 
 #define SHAREMIND_FUTURE_COMMON(T) \
     friend class Promise<T>; \
+    template <typename, typename> \
+    friend class Detail::Future::Awaiter; \
 private: /* Types: */ \
     using SharedStatePtr = std::shared_ptr<Detail::Future::SharedState<T> >; \
 public: /* Methods: */ \
@@ -312,6 +543,11 @@ public: /* Methods: */ \
         return SharedStatePtr(std::move(m_state))->takeValue(); \
     } \
     bool isValid() const noexcept { return m_state.operator bool(); } \
+    /* The token is inherited by continuations attached via then(): */ \
+    CancellationToken const & cancellationToken() const noexcept { \
+        assert(m_state); \
+        return m_state->m_cancellationToken; \
+    } \
     bool isReady() const noexcept { \
         assert(m_state); \
         return m_state->ready(); \
@@ -336,6 +572,8 @@ public: /* Methods: */ \
     } \
     void swap(Future<T> & other) noexcept \
     { return m_state.swap(other.m_state); } \
+    /* Converts this future into a future which can be shared: */ \
+    SharedFuture<T> share() noexcept; \
 private: /* Methods: */ \
     explicit Future(SharedStatePtr && state) noexcept \
             : m_state(std::move(state)) \
@@ -357,13 +595,31 @@ public: /* Methods: */
         using C = Detail::Future::Continuation<Promise, Future<T>, F>;
         assert(m_state);
         auto & state = *m_state;
-        auto continuation(
-                std::make_unique<C>(std::move(*this), std::forward<F>(f)));
+        auto continuation(C::create(std::move(*this), std::forward<F>(f)));
         auto r(continuation->m_promise.takeFuture());
         state.then(std::move(continuation));
         return r;
     }
 
+    /**
+      \brief Like then(f), but runs the continuation through the given executor
+             (e.g. a ThreadPool or a Strand) unless already running in it.
+      \warning The executor must outlive the continuation.
+    */
+    template <typename Executor, typename F>
+    auto then(Executor & executor, F && f) {
+        using C = Detail::Future::Continuation<Promise, Future<T>, F>;
+        using EC = Detail::Future::ExecutorContinuation<Executor>;
+        assert(m_state);
+        auto & state = *m_state;
+        auto executorContinuation(std::make_unique<EC>(executor));
+        auto continuation(C::create(std::move(*this), std::forward<F>(f)));
+        auto r(continuation->m_promise.takeFuture());
+        executorContinuation->m_continuation = std::move(continuation);
+        state.then(std::move(executorContinuation));
+        return r;
+    }
+
 };
 
 template <>
@@ -378,23 +634,178 @@ public: /* Methods: */
         using C = Detail::Future::Continuation<Promise, Future<void>, F>;
         assert(m_state);
         auto & state = *m_state;
-        auto continuation(
-                std::make_unique<C>(std::move(*this), std::forward<F>(f)));
+        auto continuation(C::create(std::move(*this), std::forward<F>(f)));
         auto r(continuation->m_promise.takeFuture());
         state.then(std::move(continuation));
         return r;
     }
 
+    /**
+      \brief Like then(f), but runs the continuation through the given executor
+             (e.g. a ThreadPool or a Strand) unless already running in it.
+      \warning The executor must outlive the continuation.
+    */
+    template <typename Executor, typename F>
+    auto then(Executor & executor, F && f) {
+        using C = Detail::Future::Continuation<Promise, Future<void>, F>;
+        using EC = Detail::Future::ExecutorContinuation<Executor>;
+        assert(m_state);
+        auto & state = *m_state;
+        auto executorContinuation(std::make_unique<EC>(executor));
+        auto continuation(C::create(std::move(*this), std::forward<F>(f)));
+        auto r(continuation->m_promise.takeFuture());
+        executorContinuation->m_continuation = std::move(continuation);
+        state.then(std::move(executorContinuation));
+        return r;
+    }
+
 };
 
 #undef SHAREMIND_FUTURE_COMMON
 
+/**
+  \brief A future which allows const access to its value from any number of
+         copies, and attaching any number of continuations.
+
+  Continuations of shared futures are kept in a lock-free intrusive list in the
+  shared state, and are run in the order of attachment once the shared state
+  becomes ready. Each continuation receives a copy of the shared future.
+*/
+template <typename T>
+class SharedFuture {
+
+    static_assert(!std::is_reference<T>::value, "");
+
+    friend class Future<T>;
+
+private: /* Types: */
+
+    using SharedStatePtr = std::shared_ptr<Detail::Future::SharedState<T> >;
+
+public: /* Methods: */
+
+    SharedFuture() noexcept {}
+    SharedFuture(SharedFuture &&) noexcept = default;
+    SharedFuture(SharedFuture const &) noexcept = default;
+    SharedFuture & operator=(SharedFuture &&) noexcept = default;
+    SharedFuture & operator=(SharedFuture const &) noexcept = default;
+
+    SharedFuture(Future<T> && future) noexcept
+        : SharedFuture(future.share())
+    {}
+
+    /**
+      \brief Waits for the value to become ready.
+      \returns a reference to the value, valid as long as any copy of this
+               shared future (or any of its continuations) exists.
+      \throws the exception, if the promise was fulfilled with an exception.
+    */
+    decltype(auto) get() const {
+        assert(m_state);
+        return m_state->sharedValue();
+    }
+
+    bool isValid() const noexcept { return m_state.operator bool(); }
+
+    /** \returns the token inherited by continuations attached via then(). */
+    CancellationToken const & cancellationToken() const noexcept {
+        assert(m_state);
+        return m_state->m_cancellationToken;
+    }
+
+    bool isReady() const noexcept {
+        assert(m_state);
+        return m_state->ready();
+    }
+
+    void wait() const noexcept {
+        assert(m_state);
+        return m_state->wait();
+    }
+
+    template <typename Rep, typename Period>
+    bool waitFor(std::chrono::duration<Rep, Period> const & duration)
+            const noexcept
+    {
+        assert(m_state);
+        return m_state->waitFor(duration);
+    }
+
+    template <typename Clock, typename Duration>
+    bool waitUntil(std::chrono::time_point<Clock, Duration> const & timePoint)
+            const noexcept
+    {
+        assert(m_state);
+        return m_state->waitUntil(timePoint);
+    }
+
+    /**
+      \brief Attaches a continuation, which receives a copy of this shared
+             future when it becomes ready.
+      \returns a future for the result of the continuation.
+    */
+    template <typename F>
+    auto then(F && f) const {
+        using C = Detail::Future::Continuation<Promise, SharedFuture<T>, F>;
+        assert(m_state);
+        auto continuation(C::create(SharedFuture(*this), std::forward<F>(f)));
+        auto r(continuation->m_promise.takeFuture());
+        m_state->thenShared(std::move(continuation));
+        return r;
+    }
+
+    /**
+      \brief Like then(f), but runs the continuation through the given executor
+             (e.g. a ThreadPool or a Strand) unless already running in it.
+      \warning The executor must outlive the continuation.
+    */
+    template <typename Executor, typename F>
+    auto then(Executor & executor, F && f) const {
+        using C = Detail::Future::Continuation<Promise, SharedFuture<T>, F>;
+        using EC = Detail::Future::ExecutorContinuation<Executor>;
+        assert(m_state);
+        auto executorContinuation(std::make_unique<EC>(executor));
+        auto continuation(C::create(SharedFuture(*this), std::forward<F>(f)));
+        auto r(continuation->m_promise.takeFuture());
+        executorContinuation->m_continuation = std::move(continuation);
+        m_state->thenShared(std::move(executorContinuation));
+        return r;
+    }
+
+    void swap(SharedFuture<T> & other) noexcept
+    { return m_state.swap(other.m_state); }
+
+private: /* Methods: */
+
+    explicit SharedFuture(SharedStatePtr && state) noexcept
+            : m_state(std::move(state))
+    {}
+
+private: /* Fields: */
+
+    SharedStatePtr m_state;
+
+};
+
+template <typename T>
+inline SharedFuture<T> Future<T>::share() noexcept {
+    assert(m_state);
+    return SharedFuture<T>(std::move(m_state));
+}
+
+inline SharedFuture<void> Future<void>::share() noexcept {
+    assert(m_state);
+    return SharedFuture<void>(std::move(m_state));
+}
+
 
 template <typename T> class PackagedTask;
 
 
 #define SHAREMIND_PROMISE_COMMON(T) \
         template <typename T_> friend class PackagedTask; \
+        template <template <typename> class, typename, typename> \
+        friend struct Detail::Future::Continuation; \
     private: /* Types: */ \
         enum Invalid_ { INVALID_ }; \
         using SharedStatePtr = \
@@ -406,6 +817,17 @@ template <typename T> class PackagedTask;
             : m_state(std::make_shared<Detail::Future::SharedState<T> >()) \
             , m_futureState(m_state) \
         {} \
+        /* Continuations attached to the future of this promise are skipped \
+           when cancellation is requested for the given token: */ \
+        explicit Promise(CancellationToken token) : Promise() \
+        { m_state->m_cancellationToken = std::move(token); } \
+        /* Allocates the shared state using the given allocator: */ \
+        template <typename Alloc> \
+        Promise(std::allocator_arg_t const, Alloc const & alloc) \
+            : m_state(std::allocate_shared< \
+                            Detail::Future::SharedState<T> >(alloc)) \
+            , m_futureState(m_state) \
+        {} \
         Promise(Promise &&) noexcept = default; \
         Promise & operator=(Promise &&) noexcept = default; \
         ~Promise() noexcept { \
@@ -431,6 +853,10 @@ template <typename T> class PackagedTask;
         } \
         bool isValid() const noexcept \
         { return static_cast<bool>(m_state); } \
+        CancellationToken const & cancellationToken() const noexcept { \
+            assert(m_state); \
+            return m_state->m_cancellationToken; \
+        } \
         bool hasFuture() const noexcept \
         { return static_cast<bool>(m_futureState); } \
         Future<T> takeFuture() noexcept { \
@@ -446,6 +872,10 @@ template <typename T> class PackagedTask;
             : m_state(nullptr) \
             , m_futureState(nullptr) \
         {} \
+        explicit Promise(SharedStatePtr state) noexcept \
+            : m_state(state) \
+            , m_futureState(std::move(state)) \
+        {} \
     private: /* Fields: */ \
         SharedStatePtr m_state; \
         SharedStatePtr m_futureState;
@@ -557,6 +987,18 @@ public: /* Methods: */
         : m_function(std::forward<F>(f))
     {}
 
+    /**
+      \brief Constructs a task which is skipped (its future receiving a
+             CancelledException) if cancellation is requested for the given
+             token before the task is started. The token is also inherited by
+             continuations attached to the future of this task.
+    */
+    template <typename F>
+    PackagedTask(CancellationToken token, F && f)
+        : m_promise(std::move(token))
+        , m_function(std::forward<F>(f))
+    {}
+
     PackagedTask(PackagedTask const &) = delete;
     PackagedTask & operator=(PackagedTask const &) = delete;
 
@@ -578,6 +1020,8 @@ public: /* Methods: */
 
     template <typename ... Args>
     void operator()(Args && ... args) noexcept {
+        if (m_promise.cancellationToken().isCancelled())
+            return m_promise.setException(CancelledException());
         try {
             m_promise.setValue(m_function(std::forward<Args>(args)...));
         } catch (...) {
@@ -604,15 +1048,169 @@ private: /* Methods: */
 
 };
 
+#ifdef SHAREMIND_FUTURE_HAVE_COROUTINES
+namespace Detail {
+namespace Future {
+
+/**
+  \brief Awaiter for a Future, used by co_await.
+
+  The awaiter attaches itself directly to the shared state of the future as a
+  continuation, hence no allocations are done when suspending. If Executor is
+  not void, the coroutine is resumed through the given executor, unless the
+  continuation is run in that executor already.
+*/
+template <typename T, typename Executor>
+class Awaiter final: private ContinuationBase {
+
+public: /* Methods: */
+
+    template <typename E = Executor,
+              typename = typename std::enable_if<
+                                std::is_void<E>::value>::type>
+    explicit Awaiter(sharemind::Future<T> && future) noexcept
+        : m_future(std::move(future))
+    { assert(m_future.isValid()); }
+
+    template <typename E = Executor>
+    Awaiter(E & executor, sharemind::Future<T> && future) noexcept
+        : m_executor(std::addressof(executor))
+        , m_future(std::move(future))
+    { assert(m_future.isValid()); }
+
+    bool await_ready() const noexcept { return m_future.isReady(); }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        m_handle = handle;
+        ContinuationPtr self(this);
+        if (m_future.m_state->tryThen(self))
+            return true; // *this might already be destroyed!
+        self.release();
+        return false;
+    }
+
+    T await_resume() { return m_future.takeValue(); }
+
+private: /* Methods: */
+
+    void run() noexcept final override { resume(std::is_void<Executor>()); }
+
+    void dispose() noexcept final override {}
+
+    void runAndDispose() noexcept final override { run(); }
+
+    void resume(std::true_type) noexcept { m_handle.resume(); }
+
+    void resume(std::false_type) noexcept {
+        auto const handle = m_handle;
+        if (!runningInExecutor(
+                *m_executor,
+                IsDetected<ExecutorRunningInThisThread, Executor>()))
+        {
+            try {
+                return m_executor->execute(
+                            [handle]() noexcept { handle.resume(); });
+            } catch (...) {}
+        }
+        handle.resume();
+    }
+
+private: /* Fields: */
+
+    typename std::conditional<std::is_void<Executor>::value,
+                              void *,
+                              Executor *>::type m_executor = nullptr;
+    sharemind::Future<T> m_future;
+    std::coroutine_handle<> m_handle;
+
+};
+
+template <typename T>
+struct CoroutinePromiseBase {
+
+/* Methods: */
+
+    sharemind::Future<T> get_return_object() noexcept
+    { return m_promise.takeFuture(); }
+
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() noexcept
+    { m_promise.setException(std::current_exception()); }
+
+/* Fields: */
+
+    Promise<T> m_promise;
+
+};
+
+/**
+  \brief The coroutine promise type for coroutines returning Future<T>.
+
+  The return value is constructed directly into the shared state of the
+  returned future.
+*/
+template <typename T>
+struct CoroutinePromise: CoroutinePromiseBase<T> {
+
+    template <typename U = T>
+    void return_value(U && value)
+    { this->m_promise.emplaceValue(std::forward<U>(value)); }
+
+};
+
+template <>
+struct CoroutinePromise<void>: CoroutinePromiseBase<void> {
+
+    void return_void() noexcept { m_promise.setReady(); }
+
+};
+
+} /* namespace Future { */
+} /* namespace Detail { */
+
+/** \brief Allows a future to be co_await-ed. */
+template <typename T>
+inline Detail::Future::Awaiter<T, void> operator co_await(Future<T> && future)
+        noexcept
+{ return Detail::Future::Awaiter<T, void>(std::move(future)); }
+
+/**
+  \brief Awaits the given future and resumes the awaiting coroutine through
+         the given executor (e.g. a ThreadPool or a Strand), unless the future
+         is completed in that executor already. If the future is ready before
+         suspending, the coroutine continues without being rescheduled.
+  \warning The executor must outlive the suspension.
+*/
+template <typename Executor, typename T>
+inline Detail::Future::Awaiter<T, Executor> resumeOn(Executor & executor,
+                                                     Future<T> && future)
+        noexcept
+{ return Detail::Future::Awaiter<T, Executor>(executor, std::move(future)); }
+#endif /* SHAREMIND_FUTURE_HAVE_COROUTINES */
+
 } /* namespace sharemind { */
 
 namespace std {
 
+#ifdef SHAREMIND_FUTURE_HAVE_COROUTINES
+template <typename T, typename ... Args>
+struct coroutine_traits<sharemind::Future<T>, Args...> {
+    using promise_type = sharemind::Detail::Future::CoroutinePromise<T>;
+};
+#endif
+
 template <typename T>
 inline void swap(sharemind::Future<T> & lhs, sharemind::Future<T> & rhs)
         noexcept
 { return lhs.swap(rhs); }
 
+template <typename T>
+inline void swap(sharemind::SharedFuture<T> & lhs,
+                 sharemind::SharedFuture<T> & rhs) noexcept
+{ return lhs.swap(rhs); }
+
 template <typename T>
 inline void swap(sharemind::Promise<T> & lhs, sharemind::Promise<T> & rhs)
         noexcept
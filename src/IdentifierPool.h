@@ -20,18 +20,323 @@
 #ifndef SHAREMIND_IDENTIFIERPOOL_H
 #define SHAREMIND_IDENTIFIERPOOL_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <stdexcept>
-#include <set>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 #include "detail/ExceptionMacros.h"
 #include "Exception.h"
 #include "StrongType.h"
 
 
 namespace sharemind {
+namespace Detail {
+namespace IdentifierPool {
+
+/**
+  \brief A sparse hierarchical bitmap of reserved identifiers of type T.
+
+  The bitmap is a tree with a fan-out of 64. Every bottom node holds 64 words
+  of 64 bits, one bit per identifier. Every node tracks which of its 64 slots
+  are completely reserved and which are not empty, so both finding the first
+  unreserved identifier starting from some position and reserving or
+  releasing an identifier take a constant number of steps per tree level.
+  The tree is only as tall as needed to cover the largest identifier reserved
+  since it was last empty, so small identifiers need only a few levels.
+  Subtrees are allocated on demand and freed when they become empty, so the
+  memory used is proportional to the spread of the reserved identifiers. One
+  freed node per tree level is kept for reuse, so that repeatedly reserving
+  and releasing identifiers in an otherwise empty subtree does not allocate.
+*/
+template <typename T>
+class Bitmap {
+
+private: /* Types: */
+
+    using Word = std::uint64_t;
+
+    struct Node {
+
+        /* Bit i is set iff slot i is completely reserved: */
+        Word fullMask = 0u;
+
+        /* Bit i is set iff slot i has any reserved identifiers: */
+        Word nonEmptyMask = 0u;
+
+        /* In bottom nodes the bits of identifiers, otherwise children: */
+        union Slot {
+            Word bits;
+            Node * child;
+        } slots[64u];
+
+    };
+
+    static constexpr unsigned const idBits = std::numeric_limits<T>::digits;
+
+    /* Bottom nodes cover 12 bits of identifiers, other nodes 6 bits more: */
+    static constexpr unsigned const maxLevel =
+            (idBits <= 12u) ? 0u : (idBits - 12u + 5u) / 6u;
+
+    /* The number of slots needed at maxLevel to cover all values of T: */
+    static constexpr unsigned const maxLevelSlots =
+            static_cast<unsigned>(
+                (std::uint64_t(std::numeric_limits<T>::max())
+                 >> (6u + 6u * maxLevel)) + 1u);
+
+public: /* Methods: */
+
+    Bitmap() noexcept {}
+
+    Bitmap(Bitmap const &) = delete;
+    Bitmap & operator=(Bitmap const &) = delete;
+
+    ~Bitmap() noexcept {
+        if (m_root)
+            destroy(m_root, m_rootLevel);
+        for (auto * const node : m_spare)
+            delete node;
+    }
+
+    /**
+      \brief Finds the first unreserved identifier not less than start.
+      \param[out] id Where to write the identifier found.
+      \returns whether an identifier was found.
+    */
+    bool findFree(T const start, T & id) const noexcept {
+        if (!m_root || !covers(start, m_rootLevel)) {
+            id = start;
+            return true;
+        }
+        std::uint64_t r;
+        if (!findFree(*m_root, m_rootLevel, 0u, start, r)) {
+            if (m_rootLevel >= maxLevel)
+                return false;
+            // The first identifier beyond the range covered by the tree:
+            r = std::uint64_t(1u) << (slotShift(m_rootLevel) + 6u);
+        }
+        if (r > std::numeric_limits<T>::max())
+            return false;
+        id = static_cast<T>(r);
+        return true;
+    }
+
+    /** \pre The given identifier is not reserved. */
+    void reserve(T const id) {
+        // The level of the root once it covers the given identifier:
+        unsigned newRootLevel = m_root ? m_rootLevel : 0u;
+        while (!covers(id, newRootLevel))
+            ++newRootLevel;
+
+        /* Make sure that a spare node is cached for every level which might
+           need a new node, so that the tree is not modified if allocation
+           fails. When the tree is empty or grows, the identifier is in a slot
+           of the new root other than the one of the current root, so a node
+           is needed on every level: */
+        unsigned neededLevels = newRootLevel + 1u;
+        if (m_root && (newRootLevel == m_rootLevel)) {
+            Node const * node = m_root;
+            neededLevels = 0u;
+            for (unsigned level = m_rootLevel; level; --level) {
+                auto const i = slotIndex(id, level);
+                if (!(node->nonEmptyMask & bit(i))) {
+                    neededLevels = level;
+                    break;
+                }
+                node = node->slots[i].child;
+            }
+        }
+        for (unsigned level = 0u; level < neededLevels; ++level)
+            if (!m_spare[level])
+                m_spare[level] = new Node;
+
+        if (!m_root) {
+            m_root = takeNode(newRootLevel);
+            m_rootLevel = newRootLevel;
+            markBeyondRange();
+        } else {
+            while (m_rootLevel < newRootLevel) {
+                Node * const node = takeNode(m_rootLevel + 1u);
+                node->slots[0u].child = m_root;
+                node->nonEmptyMask = bit(0u);
+                if (!~m_root->fullMask)
+                    node->fullMask = bit(0u);
+                m_root = node;
+                ++m_rootLevel;
+                markBeyondRange();
+            }
+        }
+        reserve(*m_root, m_rootLevel, id);
+    }
+
+    /** \pre The given identifier is reserved. */
+    void release(T const id) noexcept {
+        assert(m_root);
+        if (release(*m_root, m_rootLevel, id)) {
+            recycle(m_root, m_rootLevel);
+            m_root = nullptr;
+        }
+    }
+
+private: /* Methods: */
+
+    static Word bit(unsigned const i) noexcept { return Word(1u) << i; }
+
+    /** \returns whether a root at the given level covers the identifier. */
+    static bool covers(std::uint64_t const id, unsigned const level) noexcept
+    { return (level >= maxLevel) || !(id >> (slotShift(level) + 6u)); }
+
+    /** \brief Marks the slots of the root beyond the range of T as full. */
+    void markBeyondRange() noexcept {
+        if ((m_rootLevel == maxLevel) && (maxLevelSlots < 64u))
+            m_root->fullMask |= ~Word(0u) << (maxLevelSlots % 64u);
+    }
+
+    /**
+      \returns the cached node of the given level as an empty node.
+      \pre A node is cached for the given level.
+    */
+    Node * takeNode(unsigned const level) noexcept {
+        Node * const node = m_spare[level];
+        assert(node);
+        m_spare[level] = nullptr;
+        node->fullMask = 0u;
+        node->nonEmptyMask = 0u;
+        return node;
+    }
+
+    static unsigned slotShift(unsigned const level) noexcept
+    { return 6u + 6u * level; }
+
+    static unsigned slotIndex(std::uint64_t const id, unsigned const level)
+            noexcept
+    {
+        auto const shift = slotShift(level);
+        return (shift < 64u) ? static_cast<unsigned>((id >> shift) & 63u) : 0u;
+    }
+
+    static bool findFree(Node const & node,
+                         unsigned const level,
+                         std::uint64_t const base,
+                         std::uint64_t const start,
+                         std::uint64_t & r) noexcept
+    {
+        auto const startSlot = slotIndex(start, level);
+        auto const shift = slotShift(level);
+        for (auto mask = ~node.fullMask & (~Word(0u) << startSlot);
+             mask;
+             mask &= mask - 1u)
+        {
+            auto const i = static_cast<unsigned>(__builtin_ctzll(mask));
+            auto const slotBase = base + (std::uint64_t(i) << shift);
+            auto const slotStart = (i == startSlot) ? start : slotBase;
+            if (!(node.nonEmptyMask & bit(i))) {
+                r = slotStart;
+                return true;
+            }
+            if (!level) {
+                auto const free =
+                        ~node.slots[i].bits & (~Word(0u) << (slotStart & 63u));
+                if (free) {
+                    r = slotBase + static_cast<unsigned>(__builtin_ctzll(free));
+                    return true;
+                }
+            } else if (findFree(*node.slots[i].child,
+                                level - 1u,
+                                slotBase,
+                                slotStart,
+                                r))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** \returns whether the node became full. */
+    bool reserve(Node & node, unsigned const level, std::uint64_t const id)
+            noexcept
+    {
+        auto const i = slotIndex(id, level);
+        bool slotFull;
+        if (!level) {
+            auto & bits = node.slots[i].bits;
+            if (!(node.nonEmptyMask & bit(i)))
+                bits = 0u;
+            assert(!(bits & bit(id & 63u)));
+            bits |= bit(id & 63u);
+            slotFull = !~bits;
+        } else {
+            if (!(node.nonEmptyMask & bit(i)))
+                node.slots[i].child = takeNode(level - 1u);
+            slotFull = reserve(*node.slots[i].child, level - 1u, id);
+        }
+        node.nonEmptyMask |= bit(i);
+        if (slotFull)
+            node.fullMask |= bit(i);
+        return !~node.fullMask;
+    }
+
+    /** \returns whether the node became empty. */
+    bool release(Node & node, unsigned const level, std::uint64_t id) noexcept
+    {
+        auto const i = slotIndex(id, level);
+        assert(node.nonEmptyMask & bit(i));
+        bool slotEmpty;
+        if (!level) {
+            auto & bits = node.slots[i].bits;
+            assert(bits & bit(id & 63u));
+            bits &= ~bit(id & 63u);
+            slotEmpty = !bits;
+        } else {
+            auto & child = node.slots[i].child;
+            slotEmpty = release(*child, level - 1u, id);
+            if (slotEmpty)
+                recycle(child, level - 1u);
+        }
+        node.fullMask &= ~bit(i);
+        if (slotEmpty)
+            node.nonEmptyMask &= ~bit(i);
+        return !node.nonEmptyMask;
+    }
+
+    /** \brief Keeps the given empty node for reuse, or frees it. */
+    void recycle(Node * const node, unsigned const level) noexcept {
+        auto & spare = m_spare[level];
+        if (spare) {
+            delete node;
+        } else {
+            spare = node;
+        }
+    }
+
+    static void destroy(Node * const node, unsigned const level) noexcept {
+        if (level)
+            for (auto mask = node->nonEmptyMask; mask; mask &= mask - 1u)
+                destroy(node->slots[__builtin_ctzll(mask)].child,
+                        level - 1u);
+        delete node;
+    }
+
+private: /* Fields: */
+
+    Node * m_root = nullptr;
+    unsigned m_rootLevel = 0u;
+
+    /* A node per level kept for reuse by reserve(): */
+    Node * m_spare[maxLevel + 1u] = {};
+
+};
+
+} /* namespace IdentifierPool { */
+} /* namespace Detail { */
 
 template <typename T>
 class IdentifierPool {
@@ -56,20 +361,74 @@ public: /* Types: */
 
 private: /* Types: */
 
-    struct State {
+    struct State: std::enable_shared_from_this<State> {
+
+    /* Types: */
+
+        /**
+          \brief IDs reserved from the pool and cached by a single thread.
+          \note The cache does not keep the pool alive, and the cached IDs of
+                a destroyed pool are simply dropped.
+        */
+        struct ThreadCache {
+
+            ThreadCache(std::weak_ptr<State> state_) noexcept
+                : state(std::move(state_))
+            {}
+
+            ~ThreadCache() noexcept {
+                if (auto const s = state.lock())
+                    s->recycleBulk(ids.data(), ids.size());
+            }
+
+            std::weak_ptr<State> state;
+            std::vector<T> ids;
+
+        };
+
+        using ThreadCaches =
+                std::unordered_map<State const *, ThreadCache>;
 
     /* Methods: */
 
+        State(std::size_t const threadCacheSize) noexcept
+            : m_threadCacheSize(threadCacheSize)
+        {}
+
         T reserve() {
+            if (m_threadCacheSize)
+                if (auto * const cache = threadCache())
+                    return reserveCached(*cache);
             std::lock_guard<std::mutex> const guard(m_mutex);
-            T tryNext = m_tryNextId;
-            T const oldTryNext = tryNext;
-            while (m_reserved.find(tryNext) != m_reserved.end())
-                if (++tryNext == oldTryNext)
-                    throw ReserveException();
-            m_reserved.insert(tryNext);
-            m_tryNextId = tryNext + 1u;
-            return tryNext;
+            return reserveLocked();
+        }
+
+        /**
+           \brief Reserves up to the given number of IDs under a single lock.
+           \param[out] ids Where to write the reserved IDs.
+           \param[in] partial Whether to return fewer IDs on exhaustion.
+           \returns the number of IDs reserved, which is the requested number
+                    unless partial is set.
+           \throws ReserveException if no IDs (or fewer than requested, unless
+                   partial is set) could be reserved.
+        */
+        std::size_t reserveBulk(T * const ids,
+                                std::size_t const size,
+                                bool const partial)
+        {
+            std::lock_guard<std::mutex> const guard(m_mutex);
+            std::size_t i = 0u;
+            try {
+                for (; i < size; ++i)
+                    ids[i] = reserveLocked();
+            } catch (...) {
+                if (partial && i > 0u)
+                    return i;
+                while (i)
+                    m_reserved.release(ids[--i]);
+                throw;
+            }
+            return size;
         }
 
         /**
@@ -79,17 +438,132 @@ private: /* Types: */
            \post The given id is not reserved by the pool.
         */
         void recycle(T const id) noexcept {
+            if (m_threadCacheSize)
+                if (auto * const cache = threadCache())
+                    return recycleCached(*cache, id);
+            std::lock_guard<std::mutex> const guard(m_mutex);
+            m_reserved.release(id);
+        }
+
+        /** \brief Releases the given IDs back to the pool under one lock. */
+        void recycleBulk(T const * const ids, std::size_t const size)
+                noexcept
+        {
+            if (!size)
+                return;
             std::lock_guard<std::mutex> const guard(m_mutex);
-            #ifndef NDEBUG
-            auto const numErased =
-            #endif
-                    m_reserved.erase(id);
-            assert(numErased > 0u);
+            for (std::size_t i = 0u; i < size; ++i)
+                m_reserved.release(ids[i]);
+        }
+
+    private: /* Methods: */
+
+        T reserveLocked() {
+            T id;
+            if (!m_reserved.findFree(m_tryNextId, id)
+                && (!m_tryNextId || !m_reserved.findFree(0u, id)))
+                throw ReserveException();
+            m_reserved.reserve(id);
+            m_tryNextId = static_cast<T>(id + 1u);
+            return id;
+        }
+
+        T reserveCached(ThreadCache & cache) {
+            auto & ids = cache.ids;
+            if (ids.empty()) {
+                ids.resize(refillSize());
+                try {
+                    ids.resize(reserveBulk(ids.data(), ids.size(), true));
+                } catch (...) {
+                    ids.clear();
+                    throw;
+                }
+                // Hand out the lowest of the new IDs first:
+                std::reverse(ids.begin(), ids.end());
+            }
+            auto const id = ids.back();
+            ids.pop_back();
+            return id;
+        }
+
+        void recycleCached(ThreadCache & cache, T const id) noexcept {
+            auto & ids = cache.ids;
+            if (ids.size() >= m_threadCacheSize) {
+                /* Return the oldest half of the cached IDs in one batch: */
+                auto const n = ids.size() - refillSize();
+                recycleBulk(ids.data(), n);
+                ids.erase(ids.begin(), ids.begin() + n);
+            }
+            // Does not allocate, as the capacity was not decreased:
+            ids.push_back(id);
+        }
+
+        std::size_t refillSize() const noexcept
+        { return (m_threadCacheSize + 1u) / 2u; }
+
+        /**
+          \returns the cache of the calling thread for this pool, or nullptr
+                   if it could not be created.
+        */
+        ThreadCache * threadCache() noexcept {
+            /* The caches are destroyed on thread exit before other thread
+               local objects constructed earlier, which might still recycle
+               IDs, hence the destruction is tracked with trivially
+               destructible flags. */
+            static thread_local ThreadCaches * caches = nullptr;
+            static thread_local bool cachesDestroyed = false;
+            static thread_local std::size_t pruneAtSize = 0u;
+            struct CachesOwner {
+                ~CachesOwner() noexcept {
+                    delete caches;
+                    caches = nullptr;
+                    cachesDestroyed = true;
+                }
+            };
+            if (!caches) {
+                if (cachesDestroyed)
+                    return nullptr;
+                static thread_local CachesOwner const owner;
+                (void) owner;
+                caches = new (std::nothrow) ThreadCaches();
+                if (!caches)
+                    return nullptr;
+            }
+            try {
+                auto it = caches->find(this);
+                if (it != caches->end()) {
+                    if (!it->second.state.expired())
+                        return &it->second;
+                    // A stale cache of a destroyed pool at the same address:
+                    caches->erase(it);
+                }
+                /* Drop the caches of destroyed pools once the number of
+                   caches has doubled, keeping the cost amortized O(1): */
+                if (caches->size() >= pruneAtSize) {
+                    for (auto jt = caches->begin(); jt != caches->end();)
+                        jt = jt->second.state.expired()
+                             ? caches->erase(jt)
+                             : std::next(jt);
+                    pruneAtSize = std::max(std::size_t(16u),
+                                           caches->size() * 2u);
+                }
+                it = caches->emplace(
+                            this,
+                            std::weak_ptr<State>(this->shared_from_this())
+                        ).first;
+                it->second.ids.reserve(m_threadCacheSize + 1u);
+                return &it->second;
+            } catch (...) {
+                return nullptr;
+            }
         }
 
     /* Fields: */
+
+        std::size_t const m_threadCacheSize;
         std::mutex m_mutex;
-        std::set<T> m_reserved; /**< The ordered set of reserved IDs. */
+        /** The reserved IDs. */
+        Detail::IdentifierPool::Bitmap<T> m_reserved;
         T m_tryNextId = 0u;     /**< The next ID to try to reserve. */
     };
 
@@ -142,7 +616,7 @@ public: /* Types: */
 
     private: /* Methods: */
 
-        IdHolder(std::shared_ptr<State> state) noexcept
+        IdHolder(std::shared_ptr<State> state)
             : m_id(state->reserve())
             , m_state(std::move(state))
         {}
@@ -154,8 +628,87 @@ public: /* Types: */
 
     };
 
+    /** \brief A holder of a number of IDs reserved with reserveBulk(). */
+    class IdRangeHolder {
+
+        friend class IdentifierPool<T>;
+
+    public: /* Types: */
+
+        using ValueType = T;
+        using ConstIterator = typename std::vector<T>::const_iterator;
+
+    public: /* Methods: */
+
+        IdRangeHolder() {}
+
+        IdRangeHolder(IdRangeHolder const & copy) = delete;
+        IdRangeHolder & operator=(IdRangeHolder const & copy) = delete;
+
+        IdRangeHolder(IdRangeHolder && move) noexcept
+            : m_ids(std::move(move.m_ids))
+            , m_state(std::move(move.m_state))
+        {}
+
+        IdRangeHolder & operator=(IdRangeHolder && move) noexcept {
+            release();
+            m_ids = std::move(move.m_ids);
+            m_state = std::move(move.m_state);
+            return *this;
+        }
+
+        ~IdRangeHolder() noexcept { release(); }
+
+        operator bool() const noexcept { return valid(); }
+        bool valid() const noexcept { return m_state != nullptr; }
+
+        std::size_t size() const noexcept { return m_ids.size(); }
+        bool empty() const noexcept { return m_ids.empty(); }
+        T operator[](std::size_t const i) const noexcept { return m_ids[i]; }
+
+        ConstIterator begin() const noexcept { return m_ids.cbegin(); }
+        ConstIterator end() const noexcept { return m_ids.cend(); }
+
+        void release() noexcept {
+            if (m_state) {
+                m_state->recycleBulk(m_ids.data(), m_ids.size());
+                m_state.reset();
+            }
+            m_ids.clear();
+        }
+
+    private: /* Methods: */
+
+        IdRangeHolder(std::shared_ptr<State> state, std::size_t const size)
+            : m_ids(size)
+        {
+            state->reserveBulk(m_ids.data(), size, false);
+            m_state = std::move(state);
+        }
+
+    private: /* Fields: */
+
+        std::vector<T> m_ids;
+        std::shared_ptr<State> m_state = nullptr;
+
+    };
+
 public: /* Methods: */
 
+    IdentifierPool() : IdentifierPool(0u) {}
+
+    /**
+      \param[in] threadCacheSize If non-zero, every thread caches up to about
+                 this many IDs reserved from the pool and recycles IDs into
+                 its cache, so that most reserve() and recycle operations do
+                 not need to lock the pool. Note that the IDs cached by other
+                 threads can not be reserved, so ReserveException might be
+                 thrown while there are still unused IDs in such caches.
+    */
+    explicit IdentifierPool(std::size_t const threadCacheSize)
+        : m_state(std::make_shared<State>(threadCacheSize))
+    {}
+
     /**
       \brief Generates, reserves and returns an unique ID from this pool.
       \post the returned ID is reserved by the pool.
@@ -165,9 +718,20 @@ public: /* Methods: */
     */
     IdHolder reserve() { return m_state; }
 
+    /**
+      \brief Reserves the given number of unique IDs under a single lock of
+             the pool, bypassing any thread caches.
+      \returns a holder of the IDs, which are not necessarily consecutive.
+      \throws ReserveException if not enough IDs are available, in which case
+              no IDs are reserved.
+      \throws std::bad_alloc when out of memory.
+    */
+    IdRangeHolder reserveBulk(std::size_t const size)
+    { return IdRangeHolder(m_state, size); }
+
 private: /* Fields: */
 
-    std::shared_ptr<State> m_state{std::make_shared<State>()};
+    std::shared_ptr<State> m_state;
 
 };
 
@@ -231,8 +795,61 @@ public: /* Types: */
 
     };
 
+    class IdRangeHolder {
+
+    public: /* Types: */
+
+        using ValueType = StrongType<T, Tag, Mixins...>;
+
+    public: /* Methods: */
+
+        IdRangeHolder() {}
+
+        IdRangeHolder(typename IdentifierPool<T>::IdRangeHolder inner)
+                noexcept
+            : m_inner(std::move(inner))
+        {}
+
+        IdRangeHolder(IdRangeHolder const & copy) = delete;
+        IdRangeHolder & operator=(IdRangeHolder const & copy) = delete;
+
+        IdRangeHolder(IdRangeHolder && move) noexcept
+            : m_inner(std::move(move.m_inner))
+        {}
+
+        IdRangeHolder & operator=(IdRangeHolder && move) noexcept {
+            m_inner = std::move(move.m_inner);
+            return *this;
+        }
+
+        ~IdRangeHolder() noexcept = default;
+
+        operator bool() const noexcept { return m_inner.valid(); }
+        bool valid() const noexcept { return m_inner.valid(); }
+
+        std::size_t size() const noexcept { return m_inner.size(); }
+        bool empty() const noexcept { return m_inner.empty(); }
+
+        ValueType operator[](std::size_t const i) const noexcept
+        { return ValueType(m_inner[i]); }
+
+        void release() noexcept { m_inner.release(); }
+
+    private: /* Fields: */
+
+        typename IdentifierPool<T>::IdRangeHolder m_inner;
+
+    };
+
 public: /* Methods: */
 
+    IdentifierPool() {}
+
+    /** \see IdentifierPool<T>::IdentifierPool(std::size_t) */
+    explicit IdentifierPool(std::size_t const threadCacheSize)
+        : m_inner(threadCacheSize)
+    {}
+
     /**
       \brief Generates, reserves and returns an unique ID from this pool.
       \post the returned ID is reserved by the pool.
@@ -242,6 +859,10 @@ public: /* Methods: */
     */
     IdHolder reserve() { return m_inner.reserve(); }
 
+    /** \see IdentifierPool<T>::reserveBulk() */
+    IdRangeHolder reserveBulk(std::size_t const size)
+    { return m_inner.reserveBulk(size); }
+
 private: /* Fields: */
 
     IdentifierPool<T> m_inner;
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_INSTRUMENTEDMUTEX_H
+#define SHAREMIND_INSTRUMENTEDMUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/*
+  Define SHAREMIND_INSTRUMENT_MUTEXES to collect contention statistics in
+  InstrumentedMutex. Otherwise InstrumentedMutex<M> only forwards to M and the
+  statistics registry stays empty.
+*/
+
+namespace sharemind {
+
+/** \brief Contention statistics of a named (group of) mutex(es). */
+struct MutexStats {
+
+/* Types: */
+
+    using Duration = std::chrono::nanoseconds;
+
+/* Fields: */
+
+    std::string name;
+    std::uint_least64_t acquisitions;
+    std::uint_least64_t contendedAcquisitions;
+    Duration totalWaitTime;
+    Duration maxHoldTime;
+
+};
+
+namespace Detail {
+namespace InstrumentedMutex {
+
+struct Counters {
+
+/* Methods: */
+
+    Counters(std::string name_) : name(std::move(name_)) {}
+
+    void recordHold(std::chrono::nanoseconds::rep const holdTime) noexcept {
+        auto max = maxHoldTime.load(std::memory_order_relaxed);
+        while (max < holdTime
+               && !maxHoldTime.compare_exchange_weak(
+                       max,
+                       holdTime,
+                       std::memory_order_relaxed,
+                       std::memory_order_relaxed))
+        {}
+    }
+
+    MutexStats stats() const {
+        return MutexStats{
+                name,
+                acquisitions.load(std::memory_order_relaxed),
+                contendedAcquisitions.load(std::memory_order_relaxed),
+                MutexStats::Duration(
+                    totalWaitTime.load(std::memory_order_relaxed)),
+                MutexStats::Duration(
+                    maxHoldTime.load(std::memory_order_relaxed))};
+    }
+
+/* Fields: */
+
+    std::string const name;
+    std::atomic<std::uint_least64_t> acquisitions{0u};
+    std::atomic<std::uint_least64_t> contendedAcquisitions{0u};
+    std::atomic<std::chrono::nanoseconds::rep> totalWaitTime{0};
+    std::atomic<std::chrono::nanoseconds::rep> maxHoldTime{0};
+
+};
+
+} /* namespace InstrumentedMutex { */
+} /* namespace Detail { */
+
+/**
+  \brief The global registry of the statistics of all InstrumentedMutex
+         instances. Instances with the same name share their statistics.
+*/
+class MutexStatsRegistry {
+
+    template <typename> friend class InstrumentedMutex;
+
+private: /* Types: */
+
+    using Counters = Detail::InstrumentedMutex::Counters;
+
+public: /* Methods: */
+
+    static MutexStatsRegistry & instance() {
+        static MutexStatsRegistry registry;
+        return registry;
+    }
+
+    /** \returns the statistics of all named mutexes, ordered by name. */
+    std::vector<MutexStats> snapshot() const {
+        std::vector<MutexStats> r;
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        r.reserve(m_counters.size());
+        for (auto const & vp : m_counters)
+            r.emplace_back(vp.second->stats());
+        return r;
+    }
+
+    /** \brief Writes a human-readable table of snapshot() to the stream. */
+    void dump(std::ostream & os) const {
+        for (auto const & s : snapshot())
+            os << s.name
+               << ": acquisitions=" << s.acquisitions
+               << " contended=" << s.contendedAcquisitions
+               << " totalWaitNs=" << s.totalWaitTime.count()
+               << " maxHoldNs=" << s.maxHoldTime.count() << '\n';
+    }
+
+    /** \brief Resets the statistics of all named mutexes to zero. */
+    void reset() noexcept {
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        for (auto const & vp : m_counters) {
+            auto & c = *vp.second;
+            c.acquisitions.store(0u, std::memory_order_relaxed);
+            c.contendedAcquisitions.store(0u, std::memory_order_relaxed);
+            c.totalWaitTime.store(0, std::memory_order_relaxed);
+            c.maxHoldTime.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private: /* Methods: */
+
+    MutexStatsRegistry() = default;
+
+    std::shared_ptr<Counters> counters(std::string name) {
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        auto & c = m_counters[name];
+        if (!c)
+            c = std::make_shared<Counters>(std::move(name));
+        return c;
+    }
+
+private: /* Fields: */
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<Counters> > m_counters;
+
+};
+
+/**
+  \brief A wrapper around a mutex type M which records contention statistics
+         in MutexStatsRegistry when SHAREMIND_INSTRUMENT_MUTEXES is defined.
+
+  The wrapper has the same lock(), try_lock() and unlock() interface as M, and
+  is default-constructible, hence it can be used as a drop-in MutexType. M is
+  required to provide try_lock(), which is used to detect contention.
+*/
+template <typename M>
+class InstrumentedMutex {
+
+public: /* Types: */
+
+    using MutexType = M;
+
+public: /* Methods: */
+
+    #ifdef SHAREMIND_INSTRUMENT_MUTEXES
+    InstrumentedMutex() : InstrumentedMutex("<unnamed>") {}
+
+    explicit InstrumentedMutex(std::string name)
+        : m_counters(MutexStatsRegistry::instance().counters(std::move(name)))
+    {}
+    #else
+    InstrumentedMutex() noexcept {}
+    explicit InstrumentedMutex(char const *) noexcept {}
+    explicit InstrumentedMutex(std::string const &) noexcept {}
+    #endif
+
+    InstrumentedMutex(InstrumentedMutex const &) = delete;
+    InstrumentedMutex & operator=(InstrumentedMutex const &) = delete;
+
+    #ifdef SHAREMIND_INSTRUMENT_MUTEXES
+    void lock() {
+        if (!m_mutex.try_lock()) {
+            auto const waitStart(Clock::now());
+            m_mutex.lock();
+            m_lockedAt = Clock::now();
+            m_counters->contendedAcquisitions.fetch_add(
+                        1u,
+                        std::memory_order_relaxed);
+            m_counters->totalWaitTime.fetch_add(
+                        toNanoseconds(m_lockedAt - waitStart),
+                        std::memory_order_relaxed);
+        } else {
+            m_lockedAt = Clock::now();
+        }
+        m_counters->acquisitions.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    bool try_lock() {
+        if (!m_mutex.try_lock())
+            return false;
+        m_lockedAt = Clock::now();
+        m_counters->acquisitions.fetch_add(1u, std::memory_order_relaxed);
+        return true;
+    }
+
+    void unlock() {
+        m_counters->recordHold(toNanoseconds(Clock::now() - m_lockedAt));
+        m_mutex.unlock();
+    }
+    #else
+    void lock() { m_mutex.lock(); }
+    bool try_lock() { return m_mutex.try_lock(); }
+    void unlock() { m_mutex.unlock(); }
+    #endif
+
+    M & nativeMutex() noexcept { return m_mutex; }
+
+#ifdef SHAREMIND_INSTRUMENT_MUTEXES
+private: /* Types: */
+
+    using Clock = std::chrono::steady_clock;
+
+private: /* Methods: */
+
+    static std::chrono::nanoseconds::rep toNanoseconds(
+            Clock::duration const d) noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    d).count();
+    }
+#endif
+
+private: /* Fields: */
+
+    M m_mutex;
+    #ifdef SHAREMIND_INSTRUMENT_MUTEXES
+    std::shared_ptr<Detail::InstrumentedMutex::Counters> const m_counters;
+    Clock::time_point m_lockedAt;
+    #endif
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_INSTRUMENTEDMUTEX_H */
@@ -10,18 +10,57 @@
 #ifndef SHAREMIND_LRU_H
 #define SHAREMIND_LRU_H
 
+#include <boost/intrusive/list.hpp>
+#include <boost/intrusive/options.hpp>
+#include <boost/intrusive/unordered_set.hpp>
 #include <cassert>
-#include <iterator>
-#include <list>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <type_traits>
-#include <unordered_map>
+#include <utility>
 
 
 namespace sharemind {
 
-/** A simple Least Recently Used (LRU) cache. */
-template<typename key_t, typename value_t>
+/** \brief The default cost function of LRU, which counts items. */
+struct LRUUnitCost {
+    template <typename T>
+    std::size_t operator()(T const &) const noexcept { return 1u; }
+};
+
+/** \brief Statistics of an LRU cache. */
+struct LRUStats {
+    /** The number of get() calls which returned an item. */
+    std::size_t hits;
+
+    /** The number of get() calls which did not return an item. */
+    std::size_t misses;
+
+    /** The number of items demoted to weak to stay within the cost limit. */
+    std::size_t evictions;
+};
+
+/**
+  \brief A simple Least Recently Used (LRU) cache.
+
+  The most recently used items are kept alive by the cache for as long as
+  their total cost does not exceed the cost limit. Less recently used items
+  are only weakly referenced and are kept in the cache for as long as
+  something else keeps them alive.
+
+  The cost of an item is given on insertion or computed by applying
+  CostFunction to the value. By default every item costs 1, in which case the
+  cost limit is the number of items kept alive.
+
+  Every item is stored in a single node which is linked both into the hash
+  table and into a recency list. Expired weakly referenced items are removed
+  lazily when looked up, and a constant number of them is checked on every
+  insert and promotion, hence all operations are amortized O(1).
+*/
+template<typename key_t,
+         typename value_t,
+         typename CostFunction = LRUUnitCost>
 class LRU {
 
 private: /* Types: */
@@ -29,15 +68,25 @@ private: /* Types: */
     using str_ptr = std::shared_ptr<value_t>;
     using weak_ptr = std::weak_ptr<value_t>;
 
-    class CacheElement {
+    using ListHook =
+            boost::intrusive::list_base_hook<
+                boost::intrusive::link_mode<boost::intrusive::normal_link> >;
+    using SetHook =
+            boost::intrusive::unordered_set_base_hook<
+                boost::intrusive::link_mode<boost::intrusive::normal_link>,
+                boost::intrusive::store_hash<true> >;
+
+    class CacheElement: public ListHook, public SetHook {
 
         static_assert(std::is_nothrow_move_constructible<key_t>::value, "");
 
     public: /* Methods: */
 
-        CacheElement(key_t && key_, str_ptr && ptr) noexcept
+        CacheElement(key_t && key_, str_ptr && ptr, std::size_t const cost)
+                noexcept
             : m_key(std::move(key_))
             , m_strong_ptr(std::move(ptr))
+            , m_cost(cost)
         {}
 
         str_ptr getValue() noexcept
@@ -60,123 +109,249 @@ private: /* Types: */
 
         key_t const & key() const noexcept { return m_key; }
 
+        std::size_t cost() const noexcept { return m_cost; }
+
     private: /* Fields: */
 
         key_t const m_key;
         str_ptr m_strong_ptr;
         weak_ptr m_weak_ptr{m_strong_ptr};
+        std::size_t const m_cost;
+
+    };
+
+    struct ElementHasher {
+        std::size_t operator()(key_t const & key) const noexcept
+        { return std::hash<key_t>()(key); }
+
+        std::size_t operator()(CacheElement const & e) const noexcept
+        { return (*this)(e.key()); }
+    };
+
+    struct ElementEqual {
+        bool operator()(key_t const & key, CacheElement const & e) const
+        { return key == e.key(); }
 
+        bool operator()(CacheElement const & a, CacheElement const & b) const
+        { return a.key() == b.key(); }
     };
 
-    using CacheList = std::list<CacheElement>;
-    using CacheMap = std::unordered_map<key_t, typename CacheList::iterator>;
+    using CacheList =
+            boost::intrusive::list<
+                CacheElement,
+                boost::intrusive::base_hook<ListHook>,
+                boost::intrusive::constant_time_size<true> >;
+    using CacheSet =
+            boost::intrusive::unordered_set<
+                CacheElement,
+                boost::intrusive::base_hook<SetHook>,
+                boost::intrusive::hash<ElementHasher>,
+                boost::intrusive::equal<ElementEqual>,
+                boost::intrusive::power_2_buckets<true> >;
+    using Bucket = typename CacheSet::bucket_type;
+    using BucketTraits = typename CacheSet::bucket_traits;
+
+    /** The number of weak elements checked for expiry on every change. */
+    static constexpr std::size_t const weakSweepLength = 2u;
+
+    static constexpr std::size_t const initialNumBuckets = 16u;
 
 public: /* Methods: */
 
-    LRU(std::size_t const limit)
-            noexcept(std::is_nothrow_default_constructible<CacheList>::value
-                     && std::is_nothrow_default_constructible<CacheMap>::value)
-        : m_sizeLimit{(assert(limit > 0u), limit)}
+    LRU(std::size_t const costLimit, CostFunction costFunction = CostFunction())
+        : m_costLimit{(assert(costLimit > 0u), costLimit)}
+        , m_costFunction(std::move(costFunction))
     {}
 
+    /**
+      \brief Moves the contents of the given cache to this one.
+      \note The moved-from cache is left empty with its cost limit intact.
+    */
+    LRU(LRU && move)
+        : m_costLimit(move.m_costLimit)
+        , m_costFunction(std::move(move.m_costFunction))
+    { swapContents(move); }
+
+    LRU(LRU const &) = delete;
+
+    LRU & operator=(LRU && move) noexcept {
+        if (&move != this) {
+            clear();
+            m_costLimit = move.m_costLimit;
+            m_costFunction = std::move(move.m_costFunction);
+            swapContents(move);
+        }
+        return *this;
+    }
+
+    LRU & operator=(LRU const &) = delete;
+
+    ~LRU() noexcept { clear(); }
+
     /** \brief Inserts a item into the cache. */
     void insert(key_t key, str_ptr value) {
-        auto const it(m_cacheMap.find(key));
+        assert(value);
+        auto const cost = m_costFunction(static_cast<value_t const &>(*value));
+        insert(std::move(key), std::move(value), cost);
+    }
+
+    /** \brief Inserts a item with the given cost into the cache. */
+    void insert(key_t key, str_ptr value, std::size_t const cost) {
+        std::unique_ptr<CacheElement> element(
+                    new CacheElement(std::move(key), std::move(value), cost));
+        reserveBucket();
+        auto const it(m_cacheSet.find(element->key(),
+                                      ElementHasher(),
+                                      ElementEqual()));
+        if (it != m_cacheSet.end())
+            eraseElement(*it);
         // Insert new element:
-        m_cacheList.emplace_front(std::move(key), std::move(value));
-        if (it != m_cacheMap.end()) {
-            auto & origin = it->second->isStrong() ? m_cacheList : m_weakList;
-            // delete old element from list
-            origin.erase(it->second);
-            // update map
-            it->second = m_cacheList.begin();
-        } else {
-            try {
-                m_cacheMap[m_cacheList.front().key()] = m_cacheList.begin();
-            } catch (...) {
-                m_cacheList.pop_front();
-                throw;
-            }
-        }
+        m_cacheSet.insert(*element);
+        m_strongCost += cost;
+        m_cacheList.push_front(*element.release());
         grow();
     }
 
     template <typename Key>
     std::shared_ptr<value_t> get(Key && key) noexcept {
-        auto const it(m_cacheMap.find(std::forward<Key>(key)));
-        if (it == m_cacheMap.end())
+        key_t const & k = std::forward<Key>(key);
+        auto const it(m_cacheSet.find(k, ElementHasher(), ElementEqual()));
+        if (it == m_cacheSet.end()) {
+            ++m_stats.misses;
             return nullptr;
+        }
 
-        if (str_ptr ptr = it->second->getValue()) {
+        auto & element = *it;
+        if (str_ptr ptr = element.getValue()) {
             // found an element
-            if (it->second->isStrong()) {
+            if (element.isStrong()) {
                 // Move found item to front of LRU list:
                 m_cacheList.splice(m_cacheList.cbegin(),
                                    m_cacheList,
-                                   it->second);
+                                   m_cacheList.iterator_to(element));
             } else {
                 // keep a strong pointer
-                it->second->promote(ptr);
+                element.promote(ptr);
+                m_strongCost += element.cost();
                 // move found item from weakList to cacheList
                 m_cacheList.splice(m_cacheList.cbegin(),
                                    m_weakList,
-                                   it->second);
+                                   m_weakList.iterator_to(element));
                 // make sure to throw out element from cacheList
                 grow();
             }
+            ++m_stats.hits;
             return ptr;
-        } else {
-            // did not get an element, therefore it must be a expired weak_ptr
-            m_weakList.erase(it->second);
-            m_cacheMap.erase(it);
         }
 
+        // did not get an element, therefore it must be a expired weak_ptr
+        eraseElement(element);
+        ++m_stats.misses;
         return nullptr;
     }
 
+    /** \returns the number of items in the cache, including expired ones. */
+    std::size_t size() const noexcept { return m_cacheSet.size(); }
+
+    /** \returns the total cost of the items kept alive by the cache. */
+    std::size_t cost() const noexcept { return m_strongCost; }
+
+    std::size_t costLimit() const noexcept { return m_costLimit; }
+
+    LRUStats const & stats() const noexcept { return m_stats; }
+
+    void resetStats() noexcept { m_stats = LRUStats(); }
+
     /** \brief Clears this LRU cache. */
     void clear() noexcept {
-        m_cacheMap.clear();
-        m_cacheList.clear();
-        m_weakList.clear();
+        m_strongCost = 0u;
+        m_cacheSet.clear();
+        m_cacheList.clear_and_dispose(&disposeElement);
+        m_weakList.clear_and_dispose(&disposeElement);
     }
 
 private: /* Methods: */
 
+    static void disposeElement(CacheElement * const element) noexcept
+    { delete element; }
+
+    /** \brief Swaps everything but the cost limit and cost function. */
+    void swapContents(LRU & other) noexcept {
+        using std::swap;
+        swap(m_strongCost, other.m_strongCost);
+        swap(m_stats, other.m_stats);
+        swap(m_numBuckets, other.m_numBuckets);
+        swap(m_buckets, other.m_buckets);
+        m_cacheSet.swap(other.m_cacheSet);
+        m_cacheList.swap(other.m_cacheList);
+        m_weakList.swap(other.m_weakList);
+    }
+
+    void eraseElement(CacheElement & element) noexcept {
+        m_cacheSet.erase(m_cacheSet.iterator_to(element));
+        if (element.isStrong())
+            m_strongCost -= element.cost();
+        auto & origin = element.isStrong() ? m_cacheList : m_weakList;
+        origin.erase_and_dispose(origin.iterator_to(element),
+                                 &disposeElement);
+    }
+
+    /** \brief Makes sure the hash table has room for one more element. */
+    void reserveBucket() {
+        if (m_cacheSet.size() < m_numBuckets)
+            return;
+        auto const newNumBuckets = m_numBuckets * 2u;
+        std::unique_ptr<Bucket[]> newBuckets(new Bucket[newNumBuckets]);
+        m_cacheSet.rehash(BucketTraits(newBuckets.get(), newNumBuckets));
+        m_buckets = std::move(newBuckets);
+        m_numBuckets = newNumBuckets;
+    }
+
     /** \brief Increases the size of cache or removes the least recently used
      * element */
     void grow() noexcept {
-        // demote items that are over the limit
-        while (m_cacheList.size() > m_sizeLimit) {
+        // demote items until their total cost is within the limit
+        while (m_strongCost > m_costLimit) {
+            assert(!m_cacheList.empty());
             // decrease ref count
+            m_strongCost -= m_cacheList.back().cost();
             m_cacheList.back().demote();
+            ++m_stats.evictions;
             // move from cacheList to weakList
             m_weakList.splice(m_weakList.cbegin(),
                               m_cacheList,
                               std::prev(m_cacheList.cend()));
         }
 
-        // then do garbage collection
-        for (auto it = m_weakList.cbegin();
-             it != m_weakList.cend();)
+        /* Then do garbage collection on a few of the least recently demoted
+           items, rotating the ones still alive to the front: */
+        for (std::size_t i = 0u;
+             i < weakSweepLength && !m_weakList.empty();
+             ++i)
         {
-            if (it->expired()) {
-                m_cacheMap.erase(it->key());
-                auto toRemove(it);
-                ++it;
-                m_weakList.erase(std::move(toRemove));
+            auto & element = m_weakList.back();
+            if (element.expired()) {
+                m_cacheSet.erase(m_cacheSet.iterator_to(element));
+                m_weakList.pop_back_and_dispose(&disposeElement);
             } else {
-                ++it;
+                m_weakList.splice(m_weakList.cbegin(),
+                                  m_weakList,
+                                  std::prev(m_weakList.cend()));
             }
         }
     }
 
 private: /* Fields */
 
-    std::size_t const m_sizeLimit;
+    std::size_t m_costLimit;
+    CostFunction m_costFunction;
+    std::size_t m_strongCost = 0u;
+    LRUStats m_stats{0u, 0u, 0u};
+    std::size_t m_numBuckets = initialNumBuckets;
+    std::unique_ptr<Bucket[]> m_buckets{new Bucket[initialNumBuckets]};
+    CacheSet m_cacheSet{BucketTraits(m_buckets.get(), m_numBuckets)};
     CacheList m_cacheList;
     CacheList m_weakList;
-    CacheMap m_cacheMap;
 
 }; /* class LRU { */
 
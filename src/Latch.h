@@ -20,14 +20,21 @@
 #ifndef SHAREMIND_LATCH_H
 #define SHAREMIND_LATCH_H
 
+#include <atomic>
 #include <cassert>
-#include <condition_variable>
-#include <mutex>
+#include <cstdint>
 #include <type_traits>
+#include "Futex.h"
 
 
 namespace sharemind {
 
+/**
+  \brief A single-use countdown latch.
+
+  Counting down and checking readiness are lock-free, and the futex is only
+  used when some thread is actually blocked in wait().
+*/
 template <typename Counter = unsigned>
 class Latch {
 
@@ -44,39 +51,46 @@ public: /* Methods: */
 
     /** \returns whether this was counted to be the last countdown. */
     bool countDown() noexcept {
-        std::lock_guard<std::mutex> const guard(m_mutex);
-        assert(m_counter > 0u);
-        bool const r = !--m_counter;
-        if (r)
-            m_cond.notify_all();
-        return r;
+        auto const old = m_counter.fetch_sub(1u, std::memory_order_acq_rel);
+        assert(old > 0u);
+        if (old != 1u)
+            return false;
+        if (m_state.exchange(READY, std::memory_order_release) & HAS_WAITERS)
+            futexWakeAll(m_state);
+        return true;
     }
 
     void countDownAndWait() noexcept {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        assert(m_counter > 0u);
-        if (!--m_counter) {
-            m_cond.notify_all();
-        } else {
-            m_cond.wait(lock, [this]() noexcept { return !m_counter; });
-        }
+        if (!countDown())
+            wait();
     }
 
-    bool isReady() const noexcept {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        return !m_counter;
-    }
+    bool isReady() const noexcept
+    { return !m_counter.load(std::memory_order_acquire); }
 
     void wait() const noexcept {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_cond.wait(lock, [this]() noexcept { return !m_counter; });
+        auto state = m_state.load(std::memory_order_acquire);
+        while (!(state & READY)) {
+            if (!(state & HAS_WAITERS)
+                && !m_state.compare_exchange_weak(state,
+                                                  HAS_WAITERS,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_acquire))
+                continue;
+            futexWait(m_state, HAS_WAITERS);
+            state = m_state.load(std::memory_order_acquire);
+        }
     }
 
+private: /* Constants: */
+
+    static constexpr std::uint32_t READY = 1u;
+    static constexpr std::uint32_t HAS_WAITERS = 2u;
+
 private: /* Fields: */
 
-    mutable std::mutex m_mutex;
-    mutable std::condition_variable m_cond;
-    Counter m_counter;
+    std::atomic<Counter> m_counter;
+    mutable FutexWord m_state{0u};
 
 };
 
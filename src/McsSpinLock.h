@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_MCSSPINLOCK_H
+#define SHAREMIND_MCSSPINLOCK_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <sharemind/AlignToCacheLine.h>
+#include "AlignedAllocator.h"
+#include "Spinwait.h"
+
+
+namespace sharemind {
+
+/**
+  \brief A queue-based spin lock (by Mellor-Crummey and Scott) in which every
+         waiter spins on a flag in its own cache line.
+
+  Queue nodes are taken from a small per-thread cache, hence this lock can be
+  used as a drop-in MutexType with the usual lock()/unlock() interface. Each
+  thread can hold up to NODES_PER_THREAD MCS locks at once without allocating.
+*/
+class McsSpinLock {
+
+private: /* Types: */
+
+    struct SHAREMIND_ALIGN_TO_CACHE_SIZE Node {
+
+        SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(Node))
+
+        std::atomic<Node *> next{nullptr};
+        std::atomic<bool> locked{false};
+        Node * nextFree = nullptr;
+        bool allocated = false;
+
+    };
+
+    struct NodeCache {
+
+        static constexpr std::size_t NODES_PER_THREAD = 8u;
+
+        NodeCache() noexcept {
+            for (std::size_t i = 1u; i < NODES_PER_THREAD; ++i)
+                nodes[i - 1u].nextFree = &nodes[i];
+            freeNodes = &nodes[0u];
+        }
+
+        Node * acquire() {
+            if (Node * const node = freeNodes) {
+                freeNodes = node->nextFree;
+                return node;
+            }
+            Node * const node = new Node;
+            node->allocated = true;
+            return node;
+        }
+
+        void release(Node * const node) noexcept {
+            if (node->allocated) {
+                delete node;
+            } else {
+                node->nextFree = freeNodes;
+                freeNodes = node;
+            }
+        }
+
+        static NodeCache & instance() noexcept {
+            static thread_local NodeCache cache;
+            return cache;
+        }
+
+        Node nodes[NODES_PER_THREAD];
+        Node * freeNodes;
+
+    };
+
+public: /* Methods: */
+
+    McsSpinLock() noexcept {}
+
+    McsSpinLock(McsSpinLock const &) = delete;
+    McsSpinLock & operator=(McsSpinLock const &) = delete;
+
+    void lock() {
+        Node * const node = prepareNode();
+        if (Node * const pred =
+                    m_tail.exchange(node, std::memory_order_acq_rel))
+        {
+            pred->next.store(node, std::memory_order_release);
+            SpinWaiter waiter;
+            while (node->locked.load(std::memory_order_acquire))
+                waiter.wait();
+        }
+        m_owner = node;
+    }
+
+    bool try_lock() {
+        Node * const node = prepareNode();
+        Node * expected = nullptr;
+        if (!m_tail.compare_exchange_strong(expected,
+                                            node,
+                                            std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+        {
+            NodeCache::instance().release(node);
+            return false;
+        }
+        m_owner = node;
+        return true;
+    }
+
+    void unlock() noexcept {
+        Node * const node = m_owner;
+        assert(node);
+        Node * next = node->next.load(std::memory_order_acquire);
+        if (!next) {
+            Node * expected = node;
+            if (m_tail.compare_exchange_strong(expected,
+                                               nullptr,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed))
+                return NodeCache::instance().release(node);
+            // A successor is enqueueing itself:
+            SpinWaiter waiter;
+            while (!(next = node->next.load(std::memory_order_acquire)))
+                waiter.wait();
+        }
+        next->locked.store(false, std::memory_order_release);
+        NodeCache::instance().release(node);
+    }
+
+private: /* Methods: */
+
+    static Node * prepareNode() {
+        Node * const node = NodeCache::instance().acquire();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+        return node;
+    }
+
+private: /* Fields: */
+
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<Node *> m_tail{nullptr};
+    Node * m_owner = nullptr;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_MCSSPINLOCK_H */
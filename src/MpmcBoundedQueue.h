@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_MPMCBOUNDEDQUEUE_H
+#define SHAREMIND_MPMCBOUNDEDQUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <sharemind/AlignToCacheLine.h>
+#include <type_traits>
+#include <utility>
+#include "AlignedAllocator.h"
+#include "EventCount.h"
+
+
+namespace sharemind {
+
+/**
+  \brief A bounded lock-free multi-producer multi-consumer FIFO queue.
+
+  This is an array-based queue with per-slot sequence numbers (by Dmitry
+  Vyukov). Producers and consumers only contend on the respective position
+  counter, which are kept on separate cache lines. Bulk operations claim a
+  contiguous range of slots using a single atomic operation.
+
+  \note The capacity is rounded up to a power of two.
+*/
+template <typename T>
+class MpmcBoundedQueue {
+
+    static_assert(std::is_nothrow_move_constructible<T>::value,
+                  "T is required to be noexcept move constructible!");
+    static_assert(std::is_nothrow_move_assignable<T>::value,
+                  "T is required to be noexcept move assignable!");
+    static_assert(std::is_nothrow_destructible<T>::value,
+                  "T is required to be noexcept destructible!");
+
+public: /* Types: */
+
+    using ValueType = T;
+
+private: /* Types: */
+
+    struct Cell {
+
+    /* Methods: */
+
+        T & data() noexcept { return *reinterpret_cast<T *>(&storage); }
+
+    /* Fields: */
+
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    };
+
+public: /* Methods: */
+
+    MpmcBoundedQueue(MpmcBoundedQueue const &) = delete;
+    MpmcBoundedQueue & operator=(MpmcBoundedQueue const &) = delete;
+
+    explicit MpmcBoundedQueue(std::size_t const capacity)
+        : m_mask(roundUpCapacity(capacity) - 1u)
+        , m_cells(new Cell[m_mask + 1u])
+    {
+        for (std::size_t i = 0u; i <= m_mask; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MpmcBoundedQueue() noexcept {
+        auto pos = m_dequeuePos.load(std::memory_order_relaxed);
+        auto const end = m_enqueuePos.load(std::memory_order_relaxed);
+        for (; pos != end; ++pos)
+            cell(pos).data().~T();
+    }
+
+    SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(MpmcBoundedQueue))
+
+    std::size_t capacity() const noexcept { return m_mask + 1u; }
+
+    /**
+      \returns the number of elements in the queue, which might be inaccurate
+               when the queue is concurrently modified.
+    */
+    std::size_t sizeApprox() const noexcept {
+        auto const dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+        auto const enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+        auto const size = static_cast<std::ptrdiff_t>(enqueuePos - dequeuePos);
+        if (size <= 0)
+            return 0u;
+        return std::min(static_cast<std::size_t>(size), capacity());
+    }
+
+    /**
+      \brief Attempts to move the given value to the back of the queue.
+      \returns whether the value was pushed, i.e. false if the queue was full.
+    */
+    bool tryPush(T && value) noexcept {
+        std::size_t pos;
+        Cell * const c = claimPush(pos);
+        if (!c)
+            return false;
+        ::new (static_cast<void *>(&c->storage)) T(std::move(value));
+        c->sequence.store(pos + 1u, std::memory_order_release);
+        return true;
+    }
+
+    /**
+      \brief Attempts to copy the given value to the back of the queue.
+      \returns whether the value was pushed, i.e. false if the queue was full.
+    */
+    bool tryPush(T const & value) {
+        T copy(value);
+        return tryPush(std::move(copy));
+    }
+
+    /**
+      \brief Attempts to pop a value from the front of the queue.
+      \param[out] out Where to move the popped value.
+      \returns whether a value was popped, i.e. false if the queue was empty.
+    */
+    bool tryPop(T & out) noexcept {
+        std::size_t pos;
+        Cell * const c = claimPop(pos);
+        if (!c)
+            return false;
+        out = std::move(c->data());
+        c->data().~T();
+        c->sequence.store(pos + m_mask + 1u, std::memory_order_release);
+        return true;
+    }
+
+    /**
+      \brief Attempts to move up to the given number of values from the given
+             range to the back of the queue.
+      \param[in] first Iterator to the first value to move from.
+      \param[in] count The maximum number of values to push.
+      \returns the number of values pushed, which might be less than count if
+               the queue was filled.
+    */
+    template <typename InputIterator>
+    std::size_t tryPushBulk(InputIterator first, std::size_t const count)
+            noexcept
+    {
+        std::size_t pos;
+        std::size_t const n = claimBulk<0u>(m_enqueuePos, count, pos);
+        for (std::size_t i = 0u; i < n; ++i, ++first) {
+            Cell & c = cell(pos + i);
+            ::new (static_cast<void *>(&c.storage)) T(std::move(*first));
+            c.sequence.store(pos + i + 1u, std::memory_order_release);
+        }
+        return n;
+    }
+
+    /**
+      \brief Attempts to pop up to the given number of values from the front of
+             the queue.
+      \param[out] out Output iterator to move the popped values to.
+      \param[in] maxCount The maximum number of values to pop.
+      \returns the number of values popped.
+    */
+    template <typename OutputIterator>
+    std::size_t tryPopBulk(OutputIterator out, std::size_t const maxCount)
+            noexcept
+    {
+        std::size_t pos;
+        std::size_t const n = claimBulk<1u>(m_dequeuePos, maxCount, pos);
+        for (std::size_t i = 0u; i < n; ++i, ++out) {
+            Cell & c = cell(pos + i);
+            *out = std::move(c.data());
+            c.data().~T();
+            c.sequence.store(pos + i + m_mask + 1u, std::memory_order_release);
+        }
+        return n;
+    }
+
+private: /* Methods: */
+
+    static std::size_t roundUpCapacity(std::size_t const capacity) noexcept {
+        assert(capacity <= std::numeric_limits<std::size_t>::max() / 2u + 1u);
+        std::size_t r = 1u;
+        while (r < capacity)
+            r *= 2u;
+        return r;
+    }
+
+    Cell & cell(std::size_t const pos) const noexcept
+    { return m_cells[pos & m_mask]; }
+
+    Cell * claimPush(std::size_t & pos) noexcept {
+        pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell & c = cell(pos);
+            auto const seq = c.sequence.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(
+                        pos,
+                        pos + 1u,
+                        std::memory_order_relaxed))
+                    return &c;
+            } else if (diff < 0) {
+                return nullptr; // Full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Cell * claimPop(std::size_t & pos) noexcept {
+        pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell & c = cell(pos);
+            auto const seq = c.sequence.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(seq - (pos + 1u));
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(
+                        pos,
+                        pos + 1u,
+                        std::memory_order_relaxed))
+                    return &c;
+            } else if (diff < 0) {
+                return nullptr; // Empty
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+      Claims up to maxCount consecutive cells which are ready for pushing
+      (OFFSET=0) or popping (OFFSET=1) by advancing the given position.
+    */
+    template <std::size_t OFFSET>
+    std::size_t claimBulk(std::atomic<std::size_t> & position,
+                          std::size_t const maxCount,
+                          std::size_t & pos) noexcept
+    {
+        if (maxCount <= 0u)
+            return 0u;
+        pos = position.load(std::memory_order_relaxed);
+        for (;;) {
+            std::size_t n = 0u;
+            std::ptrdiff_t diff;
+            do {
+                auto const seq =
+                        cell(pos + n).sequence.load(std::memory_order_acquire);
+                diff = static_cast<std::ptrdiff_t>(seq - (pos + n + OFFSET));
+                if (diff != 0)
+                    break;
+            } while (++n < maxCount && n <= m_mask);
+            if (n > 0u) {
+                if (position.compare_exchange_weak(pos,
+                                                   pos + n,
+                                                   std::memory_order_relaxed))
+                    return n;
+            } else if (diff < 0) {
+                return 0u; // Full or empty
+            } else {
+                pos = position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private: /* Fields: */
+
+    std::size_t const m_mask;
+    std::unique_ptr<Cell[]> const m_cells;
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<std::size_t> m_enqueuePos{0u};
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<std::size_t> m_dequeuePos{0u};
+
+};
+
+/**
+  \brief A MpmcBoundedQueue with blocking push and pop operations.
+
+  Wakeups are signalled using event counts, hence pushing and popping only
+  incur a fence and a relaxed load when nobody is blocked.
+*/
+template <typename T>
+class BlockingMpmcBoundedQueue {
+
+public: /* Types: */
+
+    using ValueType = T;
+
+public: /* Methods: */
+
+    explicit BlockingMpmcBoundedQueue(std::size_t const capacity)
+        : m_queue(capacity)
+    {}
+
+    SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(BlockingMpmcBoundedQueue))
+
+    std::size_t capacity() const noexcept { return m_queue.capacity(); }
+    std::size_t sizeApprox() const noexcept { return m_queue.sizeApprox(); }
+
+    bool tryPush(T && value) noexcept {
+        if (!m_queue.tryPush(std::move(value)))
+            return false;
+        m_notEmpty.notifyOne();
+        return true;
+    }
+
+    bool tryPush(T const & value) {
+        T copy(value);
+        return tryPush(std::move(copy));
+    }
+
+    bool tryPop(T & out) noexcept {
+        if (!m_queue.tryPop(out))
+            return false;
+        m_notFull.notifyOne();
+        return true;
+    }
+
+    template <typename InputIterator>
+    std::size_t tryPushBulk(InputIterator first, std::size_t const count)
+            noexcept
+    {
+        auto const r = m_queue.tryPushBulk(std::move(first), count);
+        if (r > 0u)
+            m_notEmpty.notifyAll();
+        return r;
+    }
+
+    template <typename OutputIterator>
+    std::size_t tryPopBulk(OutputIterator out, std::size_t const maxCount)
+            noexcept
+    {
+        auto const r = m_queue.tryPopBulk(std::move(out), maxCount);
+        if (r > 0u)
+            m_notFull.notifyAll();
+        return r;
+    }
+
+    /** \brief Moves the given value to the back of the queue, blocking while
+               the queue is full. */
+    void push(T && value) noexcept
+    { m_notFull.await([this, &value]() noexcept
+                      { return tryPush(std::move(value)); }); }
+
+    /** \brief Copies the given value to the back of the queue, blocking while
+               the queue is full. */
+    void push(T const & value) {
+        T copy(value);
+        push(std::move(copy));
+    }
+
+    /** \brief Pops a value from the front of the queue, blocking while the
+               queue is empty. */
+    void pop(T & out) noexcept
+    { m_notEmpty.await([this, &out]() noexcept { return tryPop(out); }); }
+
+    /**
+      \brief Pops a value from the front of the queue, blocking while the queue
+             is empty, until the given timeout expires.
+      \returns whether a value was popped.
+    */
+    template <typename Rep, typename Period>
+    bool popFor(T & out, std::chrono::duration<Rep, Period> const & duration)
+            noexcept
+    {
+        auto const deadline(std::chrono::steady_clock::now() + duration);
+        while (!tryPop(out)) {
+            auto const key(m_notEmpty.prepareWait());
+            if (tryPop(out)) {
+                m_notEmpty.cancelWait();
+                return true;
+            }
+            if (!m_notEmpty.waitUntil(key, deadline))
+                return tryPop(out);
+        }
+        return true;
+    }
+
+private: /* Fields: */
+
+    MpmcBoundedQueue<T> m_queue;
+    EventCount m_notEmpty;
+    EventCount m_notFull;
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_MPMCBOUNDEDQUEUE_H */
@@ -22,17 +22,74 @@
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <limits>
 #include <memory>
 #include <sharemind/AlignToCacheLine.h>
 #include <type_traits>
 #include <utility>
 #include "AlignedAllocator.h"
+#include "EventCount.h"
+#include "MpmcBoundedQueue.h"
 
 
 namespace sharemind {
+namespace Detail {
+namespace MpscQueue {
 
+template <typename T, bool COMPACT>
+struct Node;
+
+/* Each node and its next pointer on separate cache lines: */
+template <typename T>
+struct SHAREMIND_ALIGN_TO_CACHE_SIZE Node<T, false> {
+
+    Node(Node &&) = default;
+    Node(Node const &) = default;
+
+    template <typename ... Args>
+    Node(Args && ... args)
+        : next{nullptr}
+        , data{std::forward<Args>(args)...}
+    {}
+
+    SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(Node))
+
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<Node *> next;
+    T data;
+
+};
+
+/* Compact nodes with the default alignment for small T: */
 template <typename T>
+struct Node<T, true> {
+
+    Node(Node &&) = default;
+    Node(Node const &) = default;
+
+    template <typename ... Args>
+    Node(Args && ... args)
+        : next{nullptr}
+        , data{std::forward<Args>(args)...}
+    {}
+
+    std::atomic<Node *> next;
+    T data;
+
+};
+
+} /* namespace MpscQueue { */
+} /* namespace Detail { */
+
+/**
+  \brief A wait-free multi-producer single-consumer unbounded FIFO queue.
+  \tparam T The type of the elements.
+  \tparam COMPACT If false (the default), every node spans at least two cache
+                  lines to avoid false sharing. If true, nodes are allocated
+                  with the default alignment, which is cheaper for small T.
+*/
+template <typename T, bool COMPACT = false>
 class MpscWaitFreeSemiIntrusiveQueue {
 
     static_assert(std::is_nothrow_move_assignable<T>::value,
@@ -40,21 +97,59 @@ class MpscWaitFreeSemiIntrusiveQueue {
 
 public: /* Types: */
 
-    struct SHAREMIND_ALIGN_TO_CACHE_SIZE Node {
+    using Node = Detail::MpscQueue::Node<T, COMPACT>;
+
+    /**
+      \brief A lock-free bounded pool of nodes, to be used by producers for
+             obtaining nodes for push() instead of allocating new ones, and by
+             the consumer for returning nodes obtained from pop().
+    */
+    class NodePool {
+
+    public: /* Methods: */
+
+        explicit NodePool(std::size_t const capacity) : m_nodes(capacity) {}
 
-        Node(Node &&) = default;
-        Node(Node const &) = default;
+        NodePool(NodePool const &) = delete;
+        NodePool & operator=(NodePool const &) = delete;
 
+        ~NodePool() noexcept {
+            Node * node;
+            while (m_nodes.tryPop(node))
+                delete node;
+        }
+
+        /**
+          \returns a node from the pool, or a newly allocated node if the pool
+                   is empty, holding a T constructed from the given arguments.
+        */
         template <typename ... Args>
-        Node(Args && ... args)
-            : next{nullptr}
-            , data{std::forward<Args>(args)...}
-        {}
+        std::unique_ptr<Node> acquire(Args && ... args) {
+            Node * node;
+            if (!m_nodes.tryPop(node))
+                return std::make_unique<Node>(std::forward<Args>(args)...);
+            std::unique_ptr<Node> r{node};
+            assert(!r->next.load(std::memory_order_relaxed));
+            r->data = T(std::forward<Args>(args)...);
+            return r;
+        }
+
+        /**
+          \brief Returns the given node to the pool, or deletes it if the pool
+                 is full.
+        */
+        void release(std::unique_ptr<Node> node) noexcept {
+            assert(node);
+            assert(!node->next.load(std::memory_order_relaxed));
+            if (m_nodes.tryPush(node.get()))
+                node.release();
+        }
+
+        std::size_t capacity() const noexcept { return m_nodes.capacity(); }
 
-        SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(Node))
+    private: /* Fields: */
 
-        SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<Node *> next;
-        T data;
+        MpmcBoundedQueue<Node *> m_nodes;
 
     };
 
@@ -81,15 +176,15 @@ public: /* Methods: */
         Node * const newNode = node.release();
         assert(!newNode->next.load(std::memory_order_relaxed));
         Node * const oldTail =
-                m_tail.exchange(newNode, std::memory_order_relaxed);
+                m_tail.exchange(newNode, std::memory_order_acq_rel);
         assert(oldTail);
-        oldTail->next.store(newNode, std::memory_order_relaxed);
+        oldTail->next.store(newNode, std::memory_order_release);
     }
 
     std::unique_ptr<Node> pop() noexcept {
         Node * const head = m_head.load(std::memory_order_consume);
         assert(head);
-        Node * const next = head->next.load(std::memory_order_relaxed);
+        Node * const next = head->next.load(std::memory_order_acquire);
 
         if (!next)
             return nullptr;
@@ -100,6 +195,59 @@ public: /* Methods: */
         return std::unique_ptr<Node>{head};
     }
 
+    /**
+      \brief Pops up to the given number of elements, passing each popped node
+             to the given callback in FIFO order.
+      \param[in] f The callback, invoked as f(std::unique_ptr<Node>). It must
+                   not pop elements from this queue.
+      \param[in] maxCount The maximum number of elements to pop.
+      \returns the number of elements popped.
+    */
+    template <typename F>
+    std::size_t consumeBatch(F && f, std::size_t const maxCount)
+            noexcept(noexcept(f(std::declval<std::unique_ptr<Node> >())))
+    {
+        /* Producers never access m_head, hence walk the chain locally and
+           publish the new head only once, even if f throws: */
+        struct HeadPublisher {
+            ~HeadPublisher() noexcept
+            { queueHead.store(head, std::memory_order_relaxed); }
+            std::atomic<Node *> & queueHead;
+            Node * head;
+        } publisher{m_head, m_head.load(std::memory_order_relaxed)};
+        assert(publisher.head);
+        std::size_t n = 0u;
+        for (; n < maxCount; ++n) {
+            Node * const head = publisher.head;
+            Node * const next = head->next.load(std::memory_order_acquire);
+            if (!next)
+                break;
+            head->data = std::move(next->data);
+            /* The popped node must not link into the queue. This store only
+               touches the node the consumer just read from: */
+            head->next.store(nullptr, std::memory_order_relaxed);
+            publisher.head = next;
+            f(std::unique_ptr<Node>{head});
+        }
+        return n;
+    }
+
+    /**
+      \brief Pops all elements in the queue, passing each popped node to the
+             given callback in FIFO order.
+      \note Elements pushed concurrently or by the callback are popped as well.
+      \param[in] f The callback, invoked as f(std::unique_ptr<Node>). It must
+                   not pop elements from this queue.
+      \returns the number of elements popped.
+    */
+    template <typename F>
+    std::size_t popAll(F && f)
+            noexcept(noexcept(f(std::declval<std::unique_ptr<Node> >())))
+    {
+        return consumeBatch(std::forward<F>(f),
+                            std::numeric_limits<std::size_t>::max());
+    }
+
     bool empty() noexcept {
         Node * const head = m_head.load(std::memory_order_relaxed);
         assert(head);
@@ -120,6 +268,91 @@ private: /* Fields: */
 
 };
 
+/**
+  \brief A MpscWaitFreeSemiIntrusiveQueue on which the consumer can block until
+         producers push elements.
+
+  Wakeups are signalled using an event count, hence pushing only costs an
+  additional fence and a relaxed load while the consumer is not blocked.
+*/
+template <typename T, bool COMPACT = false>
+class BlockingMpscWaitFreeSemiIntrusiveQueue {
+
+public: /* Types: */
+
+    using Queue = MpscWaitFreeSemiIntrusiveQueue<T, COMPACT>;
+    using Node = typename Queue::Node;
+    using NodePool = typename Queue::NodePool;
+
+public: /* Methods: */
+
+    SHAREMIND_ALIGNEDALLOCATION_MEMBERS(
+            alignof(BlockingMpscWaitFreeSemiIntrusiveQueue))
+
+    void push(std::unique_ptr<Node> node) noexcept {
+        m_queue.push(std::move(node));
+        m_eventCount.notifyOne();
+    }
+
+    std::unique_ptr<Node> pop() noexcept { return m_queue.pop(); }
+
+    template <typename F>
+    std::size_t consumeBatch(F && f, std::size_t const maxCount)
+            noexcept(noexcept(f(std::declval<std::unique_ptr<Node> >())))
+    { return m_queue.consumeBatch(std::forward<F>(f), maxCount); }
+
+    template <typename F>
+    std::size_t popAll(F && f)
+            noexcept(noexcept(f(std::declval<std::unique_ptr<Node> >())))
+    { return m_queue.popAll(std::forward<F>(f)); }
+
+    bool empty() noexcept { return m_queue.empty(); }
+
+    /** \brief Blocks until the queue is not empty. */
+    void wait() noexcept
+    { m_eventCount.await([this]() noexcept { return !m_queue.empty(); }); }
+
+    /**
+      \brief Blocks until the queue is not empty or the given timeout expires.
+      \returns whether the queue is not empty.
+    */
+    template <typename Rep, typename Period>
+    bool waitFor(std::chrono::duration<Rep, Period> const & duration) noexcept
+    {
+        auto const deadline(std::chrono::steady_clock::now() + duration);
+        while (m_queue.empty()) {
+            auto const key(m_eventCount.prepareWait());
+            if (!m_queue.empty()) {
+                m_eventCount.cancelWait();
+                return true;
+            }
+            if (!m_eventCount.waitUntil(key, deadline))
+                return !m_queue.empty();
+        }
+        return true;
+    }
+
+    /**
+      \brief Blocks until the queue is not empty and then pops all elements.
+      \param[in] f The callback, invoked as f(std::unique_ptr<Node>). It must
+                   not pop elements from this queue.
+      \returns the number of elements popped.
+    */
+    template <typename F>
+    std::size_t waitAndPopAll(F && f)
+            noexcept(noexcept(f(std::declval<std::unique_ptr<Node> >())))
+    {
+        wait();
+        return m_queue.popAll(std::forward<F>(f));
+    }
+
+private: /* Fields: */
+
+    Queue m_queue;
+    EventCount m_eventCount;
+
+};
+
 } /* namespace sharemind { */
 
 #endif /* SHAREMIND_MPSC_WAITFREE_SEMIINTRUSIVE_QUEUE_H */
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_RWSPINLOCK_H
+#define SHAREMIND_RWSPINLOCK_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <sharemind/AlignToCacheLine.h>
+#include "AlignedAllocator.h"
+#include "Spinwait.h"
+
+
+namespace sharemind {
+namespace Detail {
+namespace RwSpinLock {
+
+inline std::size_t threadSlotHint() noexcept {
+    static std::atomic_size_t nextHint{0u};
+    static thread_local std::size_t const hint =
+            nextHint.fetch_add(1u, std::memory_order_relaxed);
+    return hint;
+}
+
+} /* namespace RwSpinLock { */
+} /* namespace Detail { */
+
+/**
+  \brief A reader-writer spin lock satisfying the SharedMutex requirements.
+
+  Readers register themselves in one of NUM_SLOTS reader counters, each on its
+  own cache line, so that concurrent readers on different cores do not contend
+  on a single cache line. Threads are distributed over the slots round-robin
+  in the order they first use any RwSpinLock. A writer first claims the writer
+  flag, which stops new readers from entering, and then waits for every slot
+  to drain. Writers are thus preferred over readers.
+*/
+template <std::size_t NUM_SLOTS = 16u>
+class BasicRwSpinLock {
+
+    static_assert(NUM_SLOTS > 0u, "At least one reader slot is required!");
+
+private: /* Types: */
+
+    struct SHAREMIND_ALIGN_TO_CACHE_SIZE ReaderSlot {
+        std::atomic_size_t readers{0u};
+    };
+
+public: /* Methods: */
+
+    SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(BasicRwSpinLock))
+
+    BasicRwSpinLock() noexcept {}
+
+    BasicRwSpinLock(BasicRwSpinLock const &) = delete;
+    BasicRwSpinLock & operator=(BasicRwSpinLock const &) = delete;
+
+    void lock() noexcept {
+        if (!tryClaimWriter()) {
+            SpinWaiter waiter; // Only constructed when contended
+            do {
+                waiter.wait();
+            } while (!tryClaimWriter());
+        }
+        waitForReaders();
+    }
+
+    bool try_lock() noexcept {
+        if (!tryClaimWriter())
+            return false;
+        for (auto const & slot : m_slots) {
+            if (slot.readers.load(std::memory_order_seq_cst)) {
+                m_writer.store(false, std::memory_order_release);
+                return false;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    void unlock() noexcept {
+        assert(m_writer.load(std::memory_order_relaxed));
+        m_writer.store(false, std::memory_order_release);
+    }
+
+    void lock_shared() noexcept {
+        auto & slot = m_slots[slotIndex()];
+        if (tryEnterShared(slot))
+            return;
+        SpinWaiter waiter; // Only constructed when contended
+        do {
+            while (m_writer.load(std::memory_order_relaxed))
+                waiter.wait();
+        } while (!tryEnterShared(slot));
+    }
+
+    bool try_lock_shared() noexcept
+    { return tryEnterShared(m_slots[slotIndex()]); }
+
+    void unlock_shared() noexcept {
+        auto & slot = m_slots[slotIndex()];
+        assert(slot.readers.load(std::memory_order_relaxed) > 0u);
+        slot.readers.fetch_sub(1u, std::memory_order_release);
+    }
+
+private: /* Methods: */
+
+    static std::size_t slotIndex() noexcept
+    { return Detail::RwSpinLock::threadSlotHint() % NUM_SLOTS; }
+
+    bool tryClaimWriter() noexcept {
+        bool expected = false;
+        return m_writer.compare_exchange_strong(expected,
+                                                true,
+                                                std::memory_order_seq_cst,
+                                                std::memory_order_relaxed);
+    }
+
+    void waitForReaders() noexcept {
+        auto slot = std::begin(m_slots);
+        auto const end = std::end(m_slots);
+        while ((slot != end) && !slot->readers.load(std::memory_order_seq_cst))
+            ++slot;
+        if (slot != end) {
+            SpinWaiter waiter; // Only constructed when readers are active
+            for (; slot != end; ++slot)
+                while (slot->readers.load(std::memory_order_seq_cst))
+                    waiter.wait();
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    /* Both the increment of the reader count and the following check of the
+       writer flag must be sequentially consistent so that a reader and a
+       writer can not both miss each other (see tryClaimWriter() and
+       waitForReaders()). */
+    bool tryEnterShared(ReaderSlot & slot) noexcept {
+        slot.readers.fetch_add(1u, std::memory_order_seq_cst);
+        if (!m_writer.load(std::memory_order_seq_cst))
+            return true;
+        slot.readers.fetch_sub(1u, std::memory_order_relaxed);
+        return false;
+    }
+
+private: /* Fields: */
+
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic<bool> m_writer{false};
+    ReaderSlot m_slots[NUM_SLOTS];
+
+};
+
+using RwSpinLock = BasicRwSpinLock<>;
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_RWSPINLOCK_H */
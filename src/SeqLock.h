@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_SEQLOCK_H
+#define SHAREMIND_SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sharemind/AlignToCacheLine.h>
+#include <type_traits>
+#include "AlignedAllocator.h"
+#include "Spinwait.h"
+
+
+namespace sharemind {
+
+/**
+  \brief A sequence lock protecting a small trivially copyable value.
+
+  Readers never block writers nor each other. A reader copies the value and
+  retries if a writer was active during the copy, hence reads are cheap when
+  writes are rare. Writers are serialized among themselves by spinning on the
+  sequence number. The value is stored as relaxed atomic words so that racing
+  reads are well-defined.
+*/
+template <typename T>
+class SeqLock {
+
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock requires a trivially copyable type!");
+
+private: /* Types: */
+
+    using Word = std::uintptr_t;
+    static constexpr std::size_t NUM_WORDS =
+            (sizeof(T) + sizeof(Word) - 1u) / sizeof(Word);
+
+public: /* Methods: */
+
+    SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(SeqLock))
+
+    SeqLock() noexcept(std::is_nothrow_default_constructible<T>::value)
+        : SeqLock(T())
+    {}
+
+    explicit SeqLock(T const & value) noexcept { storeWords(value); }
+
+    SeqLock(SeqLock const &) = delete;
+    SeqLock & operator=(SeqLock const &) = delete;
+
+    /** \returns a consistent copy of the protected value. */
+    T load() const noexcept {
+        auto seq = m_sequence.load(std::memory_order_acquire);
+        if (!(seq & 1u)) {
+            T r(loadWords());
+            if (unchangedSince(seq))
+                return r;
+        }
+        SpinWaiter waiter; // Only constructed when contended
+        for (;;) {
+            waiter.wait();
+            seq = m_sequence.load(std::memory_order_acquire);
+            if (!(seq & 1u)) {
+                T r(loadWords());
+                if (unchangedSince(seq))
+                    return r;
+            }
+        }
+    }
+
+    /** \brief Replaces the protected value. */
+    void store(T const & value) noexcept {
+        auto const seq = lock();
+        storeWords(value);
+        unlock(seq);
+    }
+
+    /**
+      \brief Atomically modifies the protected value with respect to other
+             writers.
+      \param[in] f A function applied to a copy of the current value, which is
+                   then stored back.
+    */
+    template <typename F>
+    void update(F && f) noexcept(noexcept(f(std::declval<T &>()))) {
+        struct Unlocker {
+            ~Unlocker() noexcept { seqLock.unlock(seq); }
+            SeqLock & seqLock;
+            std::size_t const seq;
+        } const unlocker{*this, lock()};
+        T value(loadWords());
+        f(value);
+        storeWords(value);
+    }
+
+private: /* Methods: */
+
+    std::size_t lock() noexcept {
+        if (auto const seq = tryLock())
+            return seq;
+        SpinWaiter waiter; // Only constructed when contended
+        for (;;) {
+            waiter.wait();
+            if (auto const seq = tryLock())
+                return seq;
+        }
+    }
+
+    /** \returns the new odd sequence number on success, zero otherwise. */
+    std::size_t tryLock() noexcept {
+        auto seq = m_sequence.load(std::memory_order_relaxed);
+        if ((seq & 1u)
+            || !m_sequence.compare_exchange_weak(seq,
+                                                 seq + 1u,
+                                                 std::memory_order_acquire,
+                                                 std::memory_order_relaxed))
+            return 0u;
+        /* Orders the following stores to the value after the odd sequence
+           number for the readers. */
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq + 1u;
+    }
+
+    /** \returns whether the value read after loading seq is consistent. */
+    bool unchangedSince(std::size_t const seq) const noexcept {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_sequence.load(std::memory_order_relaxed) == seq;
+    }
+
+    void unlock(std::size_t const seq) noexcept
+    { m_sequence.store(seq + 1u, std::memory_order_release); }
+
+    T loadWords() const noexcept {
+        Word words[NUM_WORDS];
+        for (std::size_t i = 0u; i < NUM_WORDS; ++i)
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        /* T need not be default constructible: */
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type r;
+        std::memcpy(&r, words, sizeof(T));
+        return *reinterpret_cast<T const *>(&r);
+    }
+
+    void storeWords(T const & value) noexcept {
+        Word words[NUM_WORDS] = {};
+        std::memcpy(words, &value, sizeof(T));
+        for (std::size_t i = 0u; i < NUM_WORDS; ++i)
+            m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+
+private: /* Fields: */
+
+    SHAREMIND_ALIGN_TO_CACHE_SIZE std::atomic_size_t m_sequence{0u};
+    std::atomic<Word> m_words[NUM_WORDS];
+
+};
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_SEQLOCK_H */
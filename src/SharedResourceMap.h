@@ -20,23 +20,60 @@
 #ifndef SHAREMIND_SHAREDRESOURCEMAP_H
 #define SHAREMIND_SHAREDRESOURCEMAP_H
 
+#include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <sharemind/AlignToCacheLine.h>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
+#include "AlignedAllocator.h"
+#include "Detected.h"
 
 
 namespace sharemind {
+namespace Detail {
+namespace SharedResourceMap {
+
+template <typename Hash, typename Key>
+using HashResult = decltype(Hash()(std::declval<Key const &>()));
+
+} /* namespace SharedResourceMap { */
+} /* namespace Detail { */
 
 /**
+    A map of shared resources, which are constructed on first request and
+    destroyed when the last reference to them is dropped.
+
+    The map is split into shards by key hash, each with its own lock.
+    Resources are constructed outside of any lock. Concurrent requests for a
+    resource which is being constructed wait for the construction to finish.
+    If the construction fails, one of the waiting requests retries it.
+
+    Keys which can not be hashed with Hash are supported as before, provided
+    that they are comparable with operator<. These are kept in a single
+    std::map shard, and KeyEqual is not used for them.
+
     \warning don't use resources (template parameter Value) which inherit from
              std::enable_shared_from_this unless you know what you are doing.
 */
-template <typename Key, typename Value>
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key> >
 class SharedResourceMap {
 
+public: /* Constants: */
+
+    constexpr static std::size_t defaultNumberOfShards() { return 16u; }
+
 private: /* Types: */
 
     struct DefaultConstructor_ {
@@ -52,74 +89,148 @@ private: /* Types: */
 
     /* Methods: */
 
-        template <typename C,
-                  typename K,
-                  typename Constructor,
-                  typename ... Args>
-        ValueObj_(C && c, K && k, Constructor constructor, Args && ... args)
-                noexcept
+        template <typename C>
+        ValueObj_(C && c, Key const & k)
             : container(std::forward<C>(c))
-            , key(std::forward<K>(k))
-            , realPtr(constructor(key, std::forward<Args>(args)...))
+            , key(k)
         {}
 
     /* Fields: */
 
         std::weak_ptr<InnerBase> container;
         std::weak_ptr<Value> weakPtr;
-        Key key;
+        Key const key;
         std::shared_ptr<Value> realPtr;
 
+        /** Whether realPtr has been constructed, guarded by the shard. */
+        bool ready = false;
+
     };
 
-    using Map_ = std::map<Key, std::shared_ptr<ValueObj_> >;
+    using IsHashed_ =
+            IsDetected<Detail::SharedResourceMap::HashResult, Hash, Key>;
+
+    using Map_ =
+            typename std::conditional<
+                IsHashed_::value,
+                std::unordered_map<Key,
+                                   std::shared_ptr<ValueObj_>,
+                                   Hash,
+                                   KeyEqual>,
+                std::map<Key, std::shared_ptr<ValueObj_> >
+            >::type;
+
+    struct SHAREMIND_ALIGN_TO_CACHE_SIZE Shard {
+
+    /* Methods: */
+
+        SHAREMIND_ALIGNEDALLOCATION_MEMBERS(alignof(Shard))
+
+    /* Fields: */
+
+        std::mutex m_mutex;
+
+        /** Signalled when a construction in this shard has finished. */
+        std::condition_variable m_constructedCond;
+
+        Map_ m_data;
+
+    };
 
     struct Inner final: InnerBase {
 
     /* Methods: */
 
+        Inner(std::size_t const numShards)
+            : m_numShards((assert(numShards > 0u),
+                           IsHashed_::value ? numShards : 1u))
+            , m_shards(new Shard[m_numShards])
+        {}
+
+        Shard & shardFor(Key const & key) const
+        { return shardFor(key, IsHashed_()); }
+
+        Shard & shardFor(Key const & key, std::true_type) const {
+            /* Use the high bits of a Fibonacci hash so that the shard does
+               not correlate with the bucket in the per-shard hash table: */
+            auto const h = static_cast<std::uint64_t>(Hash()(key))
+                           * UINT64_C(0x9e3779b97f4a7c15);
+            return m_shards[static_cast<std::size_t>(h >> 32u) % m_numShards];
+        }
+
+        Shard & shardFor(Key const &, std::false_type) const noexcept
+        { return m_shards[0u]; }
+
+        void elementAdded() noexcept
+        { m_size.fetch_add(1u, std::memory_order_relaxed); }
+
+        void elementRemoved() noexcept {
+            if (m_size.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+                std::lock_guard<std::mutex> const guard(m_emptyMutex);
+                m_emptyCond.notify_all();
+            }
+        }
+
         template <typename F>
         void forEach(F f) const {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            for (auto const & v : m_data)
-                if (auto ptr = v.second->weakPtr.lock())
-                    f(v.first, std::move(ptr));
+            std::vector<std::pair<Key, std::shared_ptr<Value> > > values;
+            for (std::size_t i = 0u; i < m_numShards; ++i) {
+                auto & shard = m_shards[i];
+                {
+                    std::lock_guard<std::mutex> const guard(shard.m_mutex);
+                    for (auto const & v : shard.m_data)
+                        if (auto ptr = v.second->weakPtr.lock())
+                            values.emplace_back(v.first, std::move(ptr));
+                }
+                /* Call f() without holding the lock, as dropping the last
+                   reference to a resource needs to lock the shard: */
+                for (auto & v : values)
+                    f(v.first, std::move(v.second));
+                values.clear();
+            }
         }
 
         void waitForEmpty() const noexcept {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            m_cond.wait(lock, [this]() noexcept { return m_data.empty(); });
+            std::unique_lock<std::mutex> lock(m_emptyMutex);
+            m_emptyCond.wait(
+                        lock,
+                        [this]() noexcept
+                        { return !m_size.load(std::memory_order_acquire); });
         }
 
-        auto empty() const
-                noexcept(noexcept(std::declval<Map_ const &>().empty()))
-        {
-            std::lock_guard<std::mutex> const guard(m_mutex);
-            return m_data.empty();
-        }
+        bool empty() const noexcept
+        { return !m_size.load(std::memory_order_acquire); }
 
-        auto size() const
-                noexcept(noexcept(std::declval<Map_ const &>().size()))
-        {
-            std::lock_guard<std::mutex> const guard(m_mutex);
-            return m_data.size();
-        }
+        std::size_t size() const noexcept
+        { return m_size.load(std::memory_order_acquire); }
 
     /* Fields: */
 
-        mutable std::mutex m_mutex;
-        mutable std::condition_variable m_cond;
-        Map_ m_data;
+        std::size_t const m_numShards;
+        std::unique_ptr<Shard[]> const m_shards;
+        std::atomic<std::size_t> m_size{0u};
+        mutable std::mutex m_emptyMutex;
+        mutable std::condition_variable m_emptyCond;
+
     };
 
 public: /* Types: */
 
-    using type = SharedResourceMap<Key, Value>;
+    using type = SharedResourceMap<Key, Value, Hash, KeyEqual>;
 
 public: /* Methods: */
 
+    SharedResourceMap(std::size_t const numShards = defaultNumberOfShards())
+        : m_inner(std::make_shared<Inner>(numShards))
+    {}
+
     virtual ~SharedResourceMap() noexcept {}
 
+    /**
+        \brief Calls the given function with the key and a reference to every
+               resource currently alive in the map.
+        \note The function is called without holding any internal locks.
+    */
     template <typename F>
     auto forEach(F && f) const
             noexcept(noexcept(
@@ -157,59 +268,88 @@ public: /* Methods: */
             Constructor && constructor,
             Args && ... args)
     {
-        static auto const createShared = [](std::shared_ptr<ValueObj_> valueObj)
-        {
-            std::shared_ptr<Value> r(
-                valueObj->realPtr.get(),
-                [valueObj](Value * const) mutable noexcept {
-                    if (auto cPtr = valueObj->container.lock()) {
-                        Inner & c = *static_cast<Inner *>(cPtr.get());
-                        std::lock_guard<std::mutex> const guard(c.m_mutex);
-                        auto const it = c.m_data.find(valueObj->key);
-                        if ((it != c.m_data.end())
-                            && it->second->weakPtr.expired())
-                        {
-                            valueObj.reset();
-                            c.m_data.erase(it);
-                            c.m_cond.notify_all();
-                        }
-                    }
-                });
-            valueObj->weakPtr = r;
-            return r;
-        };
-
-        std::lock_guard<std::mutex> const guard(m_inner->m_mutex);
-        auto it = m_inner->m_data.find(key);
-        if (it != m_inner->m_data.end()) {
+        Key const & k = std::forward<K>(key);
+        auto & shard = m_inner->shardFor(k);
+        std::unique_lock<std::mutex> lock(shard.m_mutex);
+        for (;;) {
+            auto const it = shard.m_data.find(k);
+            if (it == shard.m_data.end())
+                break;
             auto & obj = it->second;
-            if (auto s = obj->weakPtr.lock())
-                return s;
-            return createShared(obj);
-        } else {
-            auto const rp =
-                    m_inner->m_data.emplace(
-                        typename Map_::value_type{key, {}});
-            assert(rp.second);
-            try {
-                auto & obj = rp.first->second;
-                obj = std::make_shared<ValueObj_>(
-                            m_inner,
-                            std::forward<K>(key),
-                            std::forward<Constructor>(constructor),
-                            std::forward<Args>(args)...);
-                m_inner->m_cond.notify_all();
+            if (obj->ready) {
+                if (auto s = obj->weakPtr.lock())
+                    return s;
                 return createShared(obj);
-            } catch (...) {
-                m_inner->m_data.erase(rp.first);
-                throw;
             }
+            // Wait for the construction in progress to finish or fail:
+            shard.m_constructedCond.wait(lock);
         }
+
+        // Insert a placeholder and construct the resource without the lock:
+        auto obj(std::make_shared<ValueObj_>(m_inner, k));
+        shard.m_data.emplace(obj->key, obj);
+        m_inner->elementAdded();
+        lock.unlock();
+
+        try {
+            std::shared_ptr<Value> realPtr(
+                        std::forward<Constructor>(constructor)(
+                            obj->key,
+                            std::forward<Args>(args)...));
+            lock.lock();
+            obj->realPtr = std::move(realPtr);
+        } catch (...) {
+            lock.lock();
+            shard.m_data.erase(obj->key);
+            shard.m_constructedCond.notify_all();
+            lock.unlock();
+            m_inner->elementRemoved();
+            throw;
+        }
+        obj->ready = true;
+        shard.m_constructedCond.notify_all();
+        return createShared(obj);
+    }
+
+private: /* Methods: */
+
+    /** \pre The lock of the shard of the given object is held. */
+    static std::shared_ptr<Value> createShared(
+            std::shared_ptr<ValueObj_> valueObj)
+    {
+        auto * const realPtr = valueObj->realPtr.get();
+        auto & weakPtr = valueObj->weakPtr;
+        std::shared_ptr<Value> r(
+            realPtr,
+            [valueObj](Value * const) mutable noexcept {
+                auto cPtr(valueObj->container.lock());
+                if (!cPtr)
+                    return;
+                Inner & c = *static_cast<Inner *>(cPtr.get());
+                auto & shard = c.shardFor(valueObj->key);
+                std::shared_ptr<ValueObj_> toDestroy;
+                {
+                    std::lock_guard<std::mutex> const guard(shard.m_mutex);
+                    auto const it = shard.m_data.find(valueObj->key);
+                    if ((it == shard.m_data.end())
+                        || (it->second != valueObj)
+                        || !it->second->weakPtr.expired())
+                        return;
+                    toDestroy = std::move(it->second);
+                    shard.m_data.erase(it);
+                }
+                // Destroy the resource without holding the lock:
+                valueObj.reset();
+                toDestroy.reset();
+                c.elementRemoved();
+            });
+        weakPtr = r;
+        return r;
     }
 
 private: /* Fields: */
 
-    std::shared_ptr<Inner> m_inner{std::make_shared<Inner>()};
+    std::shared_ptr<Inner> m_inner;
 
 };
 
@@ -20,18 +20,23 @@
 #ifndef SHAREMIND_SIMPLE_WAIT_H
 #define SHAREMIND_SIMPLE_WAIT_H
 
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
+#include <cstdint>
 #include "Durations.h"
+#include "Futex.h"
 
 
 namespace sharemind {
 
+/**
+  \brief A one-shot event. notifyReady() only enters the futex when some
+         thread is actually blocked waiting.
+*/
 class SimpleWait {
 
 public: /* Methods: */
 
-    SimpleWait() noexcept : m_isReady(false) {}
+    SimpleWait() noexcept {}
 
     SimpleWait(SimpleWait &&) = delete;
     SimpleWait(const SimpleWait &) = delete;
@@ -39,9 +44,9 @@ public: /* Methods: */
     SimpleWait & operator=(const SimpleWait &) = delete;
 
     void wait() noexcept {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        while (!m_isReady)
-            m_cond.wait(lock);
+        std::uint32_t state;
+        while (!prepareWait(state))
+            futexWait(m_state, state);
     }
 
     template <typename StopTest,
@@ -50,27 +55,49 @@ public: /* Methods: */
                     LoopDuration_ && loopDuration = LoopDuration_())
             noexcept(false)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        while (!m_isReady) {
-            if (m_cond.wait_for(lock, loopDuration)
-                != std::cv_status::no_timeout)
-            {
+        std::uint32_t state;
+        while (!prepareWait(state))
+            if (!futexWaitFor(m_state, state, loopDuration))
                 stopTest();
-            }
-        }
     }
 
     void notifyReady() noexcept {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_isReady = true;
-        m_cond.notify_all();
+        if (m_state.exchange(READY, std::memory_order_release) & HAS_WAITERS)
+            futexWakeAll(m_state);
+    }
+
+private: /* Methods: */
+
+    /**
+      \returns whether ready, otherwise marks that there are waiters.
+      \param[out] state the value of the futex word to wait on.
+    */
+    bool prepareWait(std::uint32_t & state) noexcept {
+        state = m_state.load(std::memory_order_acquire);
+        for (;;) {
+            if (state & READY)
+                return true;
+            if (state & HAS_WAITERS)
+                return false;
+            if (m_state.compare_exchange_weak(state,
+                                              HAS_WAITERS,
+                                              std::memory_order_acquire,
+                                              std::memory_order_acquire))
+            {
+                state = HAS_WAITERS;
+                return false;
+            }
+        }
     }
 
+private: /* Constants: */
+
+    static constexpr std::uint32_t READY = 1u;
+    static constexpr std::uint32_t HAS_WAITERS = 2u;
+
 private: /* Fields: */
 
-    std::condition_variable m_cond;
-    mutable std::mutex m_mutex;
-    bool m_isReady;
+    FutexWord m_state{0u};
 
 };
 
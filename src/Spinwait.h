@@ -20,15 +20,200 @@
 #ifndef SHAREMIND_SPINWAIT_H
 #define SHAREMIND_SPINWAIT_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+
 namespace sharemind {
 
+/**
+  \brief Hints the processor that the calling thread is in a spin loop, using
+         "pause" on x86 and "yield" on ARM.
+*/
 inline void spinWait() noexcept {
     #if defined(__i386__) || defined(__x86_64__) \
         || defined(__amd64__) || defined(__ia64__)
     __asm__ __volatile__ ("pause");
+    #elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__ ("yield");
     #endif
 }
 
+namespace Detail {
+namespace Spinwait {
+
+inline std::size_t calibrateSpinWaitsPerMicrosecond() noexcept {
+    using namespace std::chrono;
+    constexpr std::size_t rounds = 5u;
+    constexpr std::size_t spinsPerRound = 1000u;
+    auto best = nanoseconds::max();
+    for (std::size_t i = 0u; i < rounds; ++i) {
+        auto const start(steady_clock::now());
+        for (std::size_t j = 0u; j < spinsPerRound; ++j)
+            spinWait();
+        best = std::min(best,
+                        duration_cast<nanoseconds>(steady_clock::now()
+                                                   - start));
+    }
+    auto const ns = static_cast<std::size_t>(
+                std::max(best.count(), nanoseconds::rep(1)));
+    return std::max<std::size_t>(spinsPerRound * 1000u / ns, 1u);
+}
+
+inline std::atomic<std::int_least64_t> & defaultSpinBudgetNs() noexcept {
+    static std::atomic<std::int_least64_t> value{20000};
+    return value;
+}
+
+inline std::atomic_size_t & defaultMaxBackoff() noexcept {
+    static std::atomic_size_t value{64u};
+    return value;
+}
+
+/** The calibration result, or zero if not yet calibrated. */
+inline std::atomic_size_t & spinWaitsPerMicrosecond() noexcept {
+    static std::atomic_size_t value{0u};
+    return value;
+}
+
+template <typename = void>
+struct StartupCalibration { static bool const done; };
+
+} /* namespace Spinwait { */
+} /* namespace Detail { */
+
+/**
+  \brief Measures how many spinWait() calls take about one microsecond on this
+         machine, for use by spinWaitsPerMicrosecond().
+  \note This is done automatically during the dynamic initialization of static
+        objects of programs which use spinWaitsPerMicrosecond(), but may be
+        called again, e.g. after the CPU frequency settings changed.
+  \returns the new calibration result.
+*/
+inline std::size_t calibrateSpinWait() noexcept {
+    auto const r = Detail::Spinwait::calibrateSpinWaitsPerMicrosecond();
+    Detail::Spinwait::spinWaitsPerMicrosecond().store(
+                r,
+                std::memory_order_relaxed);
+    return r;
+}
+
+/**
+  \returns the number of spinWait() calls which take about one microsecond on
+           this machine, as measured by calibrateSpinWait().
+  \note If called before the calibration at startup, e.g. from the constructor
+        of another static object, the calibration is done first.
+*/
+inline std::size_t spinWaitsPerMicrosecond() noexcept {
+    // Make sure the calibration at startup is instantiated:
+    (void) &Detail::Spinwait::StartupCalibration<>::done;
+    if (auto const r = Detail::Spinwait::spinWaitsPerMicrosecond().load(
+                            std::memory_order_relaxed))
+        return r;
+    return calibrateSpinWait();
+}
+
+namespace Detail {
+namespace Spinwait {
+
+template <typename T>
+bool const StartupCalibration<T>::done = (calibrateSpinWait(), true);
+
+} /* namespace Spinwait { */
+} /* namespace Detail { */
+
+/**
+  \brief A spin loop backoff policy.
+
+  Every call to wait() calls spinWait() an exponentially increasing number of
+  times, up to a maximum. Once the total time spent spinning exceeds the spin
+  budget, which is converted to spinWait() calls using the calibration from
+  spinWaitsPerMicrosecond(), wait() yields the processor to the scheduler
+  instead. A new SpinWaiter should be used for every spin loop.
+*/
+class SpinWaiter {
+
+public: /* Types: */
+
+    using Duration = std::chrono::nanoseconds;
+
+public: /* Methods: */
+
+    /** \brief Constructs a waiter with the process-wide default settings. */
+    SpinWaiter() noexcept
+        : SpinWaiter(defaultSpinBudget(), defaultMaxBackoff())
+    {}
+
+    /**
+      \param[in] spinBudget The time to spin before yielding.
+      \param[in] maxBackoff The maximum number of spinWait() calls per wait().
+    */
+    SpinWaiter(Duration const spinBudget, std::size_t const maxBackoff)
+            noexcept
+        : m_spinBudget(
+              static_cast<std::size_t>(std::max(spinBudget.count(),
+                                                Duration::rep(0)))
+              * spinWaitsPerMicrosecond() / 1000u)
+        , m_maxBackoff(std::max<std::size_t>(maxBackoff, 1u))
+    {}
+
+    void wait() noexcept {
+        if (m_spun < m_spinBudget) {
+            for (auto i = m_backoff; i; --i)
+                spinWait();
+            m_spun += m_backoff;
+            m_backoff = std::min(m_backoff * 2u, m_maxBackoff);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    /** \brief Restarts the backoff, e.g. after progress was made. */
+    void reset() noexcept {
+        m_backoff = 1u;
+        m_spun = 0u;
+    }
+
+    /** \returns whether wait() has escalated to yielding. */
+    bool isYielding() const noexcept { return m_spun >= m_spinBudget; }
+
+    static Duration defaultSpinBudget() noexcept {
+        return Duration(Detail::Spinwait::defaultSpinBudgetNs().load(
+                            std::memory_order_relaxed));
+    }
+
+    /** \brief Sets the spin budget of subsequently constructed waiters. */
+    static void setDefaultSpinBudget(Duration const spinBudget) noexcept {
+        Detail::Spinwait::defaultSpinBudgetNs().store(
+                    spinBudget.count(),
+                    std::memory_order_relaxed);
+    }
+
+    static std::size_t defaultMaxBackoff() noexcept {
+        return Detail::Spinwait::defaultMaxBackoff().load(
+                    std::memory_order_relaxed);
+    }
+
+    /** \brief Sets the maximum backoff of subsequently constructed waiters. */
+    static void setDefaultMaxBackoff(std::size_t const maxBackoff) noexcept {
+        Detail::Spinwait::defaultMaxBackoff().store(
+                    maxBackoff,
+                    std::memory_order_relaxed);
+    }
+
+private: /* Fields: */
+
+    std::size_t const m_spinBudget;
+    std::size_t const m_maxBackoff;
+    std::size_t m_backoff = 1u;
+    std::size_t m_spun = 0u;
+
+};
+
 } /* namespace sharemind { */
 
 #endif /* SHAREMIND_SPINWAIT_H */
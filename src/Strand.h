@@ -176,6 +176,20 @@ public: /* Methods: */
     void submit(ThreadPool::Task task) noexcept
     { m_internal->submit(std::move(task)); }
 
+    /**
+      \brief Submits the given nullary function object for serial execution.
+      \note If task allocation fails, f is left untouched.
+    */
+    template <typename F>
+    void execute(F && f)
+    { submit(ThreadPool::createSimpleTask(std::forward<F>(f))); }
+
+    /** \returns whether the calling thread is running a task of this strand. */
+    bool runningInThisThread() const noexcept {
+        return CallStack<Internal::CallStackRecursionIndicator>::contains(
+                    Internal::CallStackRecursionIndicator(m_internal.get()));
+    }
+
     std::shared_ptr<ThreadPool> stopAndJoin() noexcept
     { return m_internal->stopAndJoin(); }
 
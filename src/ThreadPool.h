@@ -105,7 +105,7 @@ public: /* Methods: */
             { m_f(std::move(task)); }
             typename std::decay<F>::type m_f;
         };
-        return createTask_(new CustomTask(std::forward<F>(f)));
+        return createTask_<CustomTask>(std::forward<F>(f));
     }
 
     template <typename F>
@@ -115,9 +115,21 @@ public: /* Methods: */
             void operator()(Task &&) final override { m_f(); }
             typename std::decay<F>::type m_f;
         };
-        return createTask_(new CustomSimpleTask(std::forward<F>(f)));
+        return createTask_<CustomSimpleTask>(std::forward<F>(f));
     }
 
+    /**
+      \brief Submits the given nullary function object for execution on this
+             thread pool.
+      \note If task allocation fails, f is left untouched.
+    */
+    template <typename F>
+    void execute(F && f) { submit(createSimpleTask(std::forward<F>(f))); }
+
+    /** \returns whether the calling thread is running a task of this pool. */
+    bool runningInThisThread() const noexcept
+    { return CallStack<ThreadPool const *>::contains(this); }
+
     void submit(Task task) noexcept {
         assert(task);
         assert(task->m_value);
@@ -147,6 +159,7 @@ protected: /* Methods: */
     ThreadPool() : ThreadPool(new TaskWrapper(nullptr)) {}
 
     void workerThread() {
+        CallStack<ThreadPool const *>::Context const context(this);
         while (Task task = waitAndPop()) {
             // this->m_value(std::move(*this)); // would segfault.
             TaskWrapper * const taskPtr = task.get();
@@ -160,6 +173,7 @@ protected: /* Methods: */
     Status workerThreadUntil(
             std::chrono::time_point<Clock, Duration> const & timepoint)
     {
+        CallStack<ThreadPool const *>::Context const context(this);
         for (;;) {
             auto r(waitAndPop(timepoint));
             if (r.first) {
@@ -175,6 +189,7 @@ protected: /* Methods: */
     }
 
     bool oneTaskWorkerThread() {
+        CallStack<ThreadPool const *>::Context const context(this);
         if (Task task = waitAndPop()) {
             // this->m_value(std::move(*this)); // would segfault.
             TaskWrapper * const taskPtr = task.get();
@@ -190,6 +205,7 @@ protected: /* Methods: */
     Status oneTaskWorkerThreadUntil(
             std::chrono::time_point<Clock, Duration> const & timepoint)
     {
+        CallStack<ThreadPool const *>::Context const context(this);
         auto r(waitAndPop(timepoint));
         if (r.first) {
             // this->m_value(std::move(*this)); // would segfault.
@@ -263,10 +279,15 @@ private: /* Methods: */
         return r;
     }
 
-    template <typename TaskSubclass>
-    static Task createTask_(TaskSubclass * const task) {
-        assert(task);
-        return Task(new TaskWrapper(std::unique_ptr<TaskBase>(task)));
+    /**
+      \note Both allocations are done before f is taken, so f is left untouched
+            if either of them fails.
+    */
+    template <typename TaskSubclass, typename F>
+    static Task createTask_(F && f) {
+        Task r(new TaskWrapper(std::unique_ptr<TaskBase>()));
+        r->m_value.reset(new TaskSubclass(std::forward<F>(f)));
+        return r;
     }
 
 private: /* Fields: */
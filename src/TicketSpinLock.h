@@ -22,6 +22,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <sharemind/AlignToCacheLine.h>
 #include "Spinwait.h"
@@ -29,12 +30,51 @@
 
 namespace sharemind {
 
-class TicketSpinLock {
+/** \brief Backoff policy for BasicTicketSpinLock which polls continuously. */
+struct TicketSpinLockNoBackoff {
+    static void wait(std::size_t const waitersAhead) noexcept
+    { (void) waitersAhead; spinWait(); }
+};
+
+/**
+  \brief Backoff policy for BasicTicketSpinLock which backs off exponentially
+         and eventually yields using SpinWaiter.
+  \note A yielded waiter whose ticket comes up stalls everyone queued behind
+        it, so this only pays off when threads outnumber the cores.
+*/
+class TicketSpinLockAdaptiveBackoff {
+
+public: /* Methods: */
+
+    void wait(std::size_t const waitersAhead) noexcept
+    { (void) waitersAhead; m_waiter.wait(); }
+
+private: /* Fields: */
+
+    SpinWaiter m_waiter;
+
+};
+
+/**
+  \brief Backoff policy for BasicTicketSpinLock which waits in proportion to
+         the number of waiters ahead in the queue before polling again, thus
+         reducing traffic on the cache line of the lock.
+*/
+template <std::size_t SPINS_PER_WAITER = 64u>
+struct TicketSpinLockProportionalBackoff {
+    static void wait(std::size_t const waitersAhead) noexcept {
+        for (auto i = waitersAhead * SPINS_PER_WAITER; i; --i)
+            spinWait();
+    }
+};
+
+template <typename Backoff>
+class BasicTicketSpinLock {
 
 public: /* Methods: */
 
     #ifndef NDEBUG
-    TicketSpinLock() {
+    BasicTicketSpinLock() {
         assert(m_active.is_lock_free());
         assert(m_next.is_lock_free());
     }
@@ -42,8 +82,22 @@ public: /* Methods: */
 
     void lock() noexcept {
         auto const ticket = m_next.fetch_add(1u, std::memory_order_relaxed);
-        while (ticket != m_active.load(std::memory_order_acquire))
-            spinWait();
+        auto active = m_active.load(std::memory_order_acquire);
+        if (active == ticket)
+            return;
+        Backoff backoff; // Only constructed when contended
+        do {
+            backoff.wait(ticket - active);
+            active = m_active.load(std::memory_order_acquire);
+        } while (active != ticket);
+    }
+
+    bool try_lock() noexcept {
+        auto ticket = m_active.load(std::memory_order_acquire);
+        return m_next.compare_exchange_strong(ticket,
+                                              ticket + 1u,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed);
     }
 
     void unlock() noexcept {
@@ -58,6 +112,12 @@ private: /* Fields: */
 
 };
 
+using TicketSpinLock = BasicTicketSpinLock<TicketSpinLockNoBackoff>;
+using ProportionalBackoffTicketSpinLock =
+        BasicTicketSpinLock<TicketSpinLockProportionalBackoff<> >;
+using AdaptiveBackoffTicketSpinLock =
+        BasicTicketSpinLock<TicketSpinLockAdaptiveBackoff>;
+
 } /* namespace Sharemind { */
 
 #endif /* SHAREMIND_TICKETSPINLOCK_H */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_WHENALL_H
+#define SHAREMIND_WHENALL_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Future.h"
+#include "Range.h"
+
+
+namespace sharemind {
+namespace Detail {
+namespace WhenAll {
+
+/**
+  \brief Shared state for gathering the results of several futures.
+
+  The counter is initialized to one more than the number of futures, the extra
+  count being held by the function attaching the continuations. This ensures
+  that the promise is not fulfilled before all continuations are attached.
+*/
+template <typename Results>
+struct State {
+
+/* Methods: */
+
+    State(std::size_t const numFutures) noexcept
+        : m_remaining(numFutures + 1u)
+    {}
+
+    void countDown() noexcept {
+        if (m_remaining.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+            m_promise.setValue(std::move(m_results));
+    }
+
+/* Fields: */
+
+    std::atomic<std::size_t> m_remaining;
+    Results m_results;
+    Promise<Results> m_promise;
+
+};
+
+template <typename T, typename Results>
+inline void attach(std::shared_ptr<State<Results> > const & state,
+                   sharemind::Future<T> & slot)
+{
+    assert(slot.isValid());
+    sharemind::Future<T> future(std::move(slot));
+    future.then(
+        [state, &slot](sharemind::Future<T> f) noexcept {
+            slot = std::move(f);
+            state->countDown();
+        });
+}
+
+template <typename Tuple, std::size_t ... Is>
+inline void attachAll(std::shared_ptr<State<Tuple> > const & state,
+                      std::index_sequence<Is...>)
+{
+    using Expander = int[];
+    static_cast<void>(
+            Expander{0, (attach(state, std::get<Is>(state->m_results)), 0)...});
+}
+
+} /* namespace WhenAll { */
+} /* namespace Detail { */
+
+/**
+  \brief Combines the given futures into a single future.
+  \param[in] futures The valid futures to combine.
+  \returns a future which becomes ready after all the given futures become
+           ready. Its value is a tuple of the given futures in their ready
+           state.
+*/
+template <typename ... Ts>
+inline Future<std::tuple<Future<Ts>...> > whenAll(Future<Ts> && ... futures) {
+    using Results = std::tuple<Future<Ts>...>;
+    auto const state(
+            std::make_shared<Detail::WhenAll::State<Results> >(
+                sizeof...(Ts)));
+    state->m_results = Results(std::move(futures)...);
+    auto r(state->m_promise.takeFuture());
+    Detail::WhenAll::attachAll(state, std::index_sequence_for<Ts...>());
+    state->countDown();
+    return r;
+}
+
+/**
+  \brief Combines the futures in the given iterator range into a single future.
+  \param[in] first Iterator to the first future.
+  \param[in] last Iterator past the last future.
+  \returns a future which becomes ready after all the given futures become
+           ready. Its value is a vector of the given futures (moved from the
+           given range) in their ready state.
+*/
+template <typename InputIterator,
+          typename F =
+                typename std::iterator_traits<InputIterator>::value_type>
+inline Future<std::vector<F> > whenAll(InputIterator first,
+                                       InputIterator last)
+{
+    using Results = std::vector<F>;
+    Results futures(std::make_move_iterator(std::move(first)),
+                    std::make_move_iterator(std::move(last)));
+    auto const state(
+            std::make_shared<Detail::WhenAll::State<Results> >(
+                futures.size()));
+    state->m_results = std::move(futures);
+    auto r(state->m_promise.takeFuture());
+    for (auto & slot : state->m_results)
+        Detail::WhenAll::attach(state, slot);
+    state->countDown();
+    return r;
+}
+
+/**
+  \brief Combines the futures in the given range into a single future.
+  \param[in] range The range of futures to move from.
+  \returns a future which becomes ready after all the given futures become
+           ready. Its value is a vector of the given futures in their ready
+           state.
+*/
+template <typename Range_, SHAREMIND_REQUIRES_CONCEPTS(BoundedRange(Range_))>
+inline auto whenAll(Range_ && range)
+{ return whenAll(std::begin(range), std::end(range)); }
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_WHENALL_H */
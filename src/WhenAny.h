@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef SHAREMIND_WHENANY_H
+#define SHAREMIND_WHENANY_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include "detail/ExceptionMacros.h"
+#include "Exception.h"
+#include "Future.h"
+#include "Range.h"
+#include "TemplateAll.h"
+
+
+namespace sharemind {
+
+SHAREMIND_DETAIL_DEFINE_EXCEPTION_CONST_MSG(Exception,
+                                            WhenAnyEmptyRangeException,
+                                            "whenAny() on an empty range!");
+
+template <typename T>
+struct WhenAnyResult {
+
+/* Fields: */
+
+    /** The index of the future which first became ready. */
+    std::size_t index;
+
+    /** The future which first became ready, in its ready state. */
+    Future<T> future;
+
+};
+
+namespace Detail {
+namespace WhenAny {
+
+template <typename T>
+struct State {
+
+/* Methods: */
+
+    void setFirst(std::size_t const index, sharemind::Future<T> && future)
+            noexcept
+    {
+        if (!m_done.exchange(true, std::memory_order_acq_rel))
+            m_promise.setValue(WhenAnyResult<T>{index, std::move(future)});
+    }
+
+/* Fields: */
+
+    std::atomic<bool> m_done{false};
+    Promise<WhenAnyResult<T> > m_promise;
+
+};
+
+template <typename T>
+inline void attach(std::shared_ptr<State<T> > const & state,
+                   std::size_t const index,
+                   sharemind::Future<T> && future)
+{
+    assert(future.isValid());
+    future.then(
+        [state, index](sharemind::Future<T> f) noexcept
+        { state->setFirst(index, std::move(f)); });
+}
+
+} /* namespace WhenAny { */
+} /* namespace Detail { */
+
+/**
+  \brief Waits for the first of the given futures to become ready.
+  \param[in] first Iterator to the first future.
+  \param[in] last Iterator past the last future.
+  \returns a future which becomes ready as soon as any of the given futures
+           becomes ready. Its value contains the index of that future and the
+           future itself. The results of the other futures are discarded. If
+           the range is empty, the returned future holds a
+           WhenAnyEmptyRangeException instead.
+*/
+template <typename InputIterator,
+          typename F =
+                typename std::iterator_traits<InputIterator>::value_type,
+          typename T = decltype(std::declval<F &>().takeValue())>
+inline Future<WhenAnyResult<T> > whenAny(InputIterator first,
+                                         InputIterator last)
+{
+    if (first == last)
+        return makeExceptionalFuture<WhenAnyResult<T> >(
+                    WhenAnyEmptyRangeException());
+    auto const state(std::make_shared<Detail::WhenAny::State<T> >());
+    auto r(state->m_promise.takeFuture());
+    for (std::size_t i = 0u; first != last; ++first, ++i)
+        Detail::WhenAny::attach(state, i, std::move(*first));
+    return r;
+}
+
+/**
+  \brief Waits for the first of the futures in the given range to become ready.
+  \param[in] range The range of futures to move from.
+  \returns the same as whenAny(std::begin(range), std::end(range)).
+*/
+template <typename Range_, SHAREMIND_REQUIRES_CONCEPTS(BoundedRange(Range_))>
+inline auto whenAny(Range_ && range)
+{ return whenAny(std::begin(range), std::end(range)); }
+
+/**
+  \brief Waits for the first of the given futures to become ready.
+  \param[in] future The first future.
+  \param[in] futures The other futures.
+  \returns a future which becomes ready as soon as any of the given futures
+           becomes ready. Its value contains the index of that future and the
+           future itself. The results of the other futures are discarded.
+*/
+template <typename T, typename ... Ts>
+inline Future<WhenAnyResult<T> > whenAny(Future<T> && future,
+                                         Future<Ts> && ... futures)
+{
+    static_assert(TemplateAll<std::is_same<T, Ts>::value...>::value,
+                  "All futures must have the same value type!");
+    auto const state(std::make_shared<Detail::WhenAny::State<T> >());
+    auto r(state->m_promise.takeFuture());
+    std::size_t i = 0u;
+    Detail::WhenAny::attach(state, i, std::move(future));
+    using Expander = int[];
+    static_cast<void>(
+            Expander{
+                0,
+                (Detail::WhenAny::attach(state, ++i, std::move(futures)),
+                 0)...});
+    return r;
+}
+
+} /* namespace sharemind { */
+
+#endif /* SHAREMIND_WHENANY_H */
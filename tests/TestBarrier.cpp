@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/Barrier.h"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "../src/Latch.h"
+#include "../src/SimpleWait.h"
+#include "../src/TestAssert.h"
+
+
+int main() {
+    { // Barrier phases:
+        constexpr std::size_t numThreads = 4u;
+        constexpr std::size_t numPhases = 200u;
+        sharemind::Barrier barrier(numThreads);
+        std::atomic<std::size_t> arrived(0u);
+        std::atomic<std::size_t> lastCount(0u);
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0u; i < numThreads; ++i)
+            threads.emplace_back(
+                        [&]() {
+                            for (std::size_t p = 0u; p < numPhases; ++p) {
+                                arrived.fetch_add(1u);
+                                if (barrier.arriveAndWait())
+                                    lastCount.fetch_add(1u);
+                                /* Everybody has arrived in this phase, but
+                                   nobody can have passed the next one: */
+                                auto const a = arrived.load();
+                                if (a < (p + 1u) * numThreads
+                                    || a > (p + 2u) * numThreads)
+                                    failed = true;
+                                barrier.arriveAndWait();
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(!failed);
+        SHAREMIND_TESTASSERT(lastCount == numPhases);
+        SHAREMIND_TESTASSERT(arrived == numPhases * numThreads);
+    }{ // Latch:
+        constexpr unsigned numThreads = 4u;
+        sharemind::Latch<> latch(numThreads + 1u);
+        sharemind::Latch<> done(numThreads);
+        std::atomic<unsigned> counter(0u);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0u; i < numThreads; ++i)
+            threads.emplace_back(
+                        [&]() {
+                            counter.fetch_add(1u);
+                            latch.countDownAndWait();
+                            SHAREMIND_TESTASSERT(latch.isReady());
+                            SHAREMIND_TESTASSERT(counter == numThreads);
+                            done.countDown();
+                        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        SHAREMIND_TESTASSERT(!latch.isReady());
+        SHAREMIND_TESTASSERT(latch.countDown());
+        done.wait();
+        SHAREMIND_TESTASSERT(done.isReady());
+        for (auto & t : threads)
+            t.join();
+        latch.wait(); // Returns immediately
+    }{ // SimpleWait:
+        sharemind::SimpleWait w;
+        std::atomic<unsigned> stopTests(0u);
+        std::thread waiter(
+                    [&]() {
+                        w.waitOrStop(
+                                [&stopTests]() { stopTests.fetch_add(1u); },
+                                sharemind::LoopDuration<>(1u));
+                        w.wait();
+                    });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        w.notifyReady();
+        waiter.join();
+        SHAREMIND_TESTASSERT(stopTests > 0u);
+        w.wait(); // Returns immediately
+    }
+}
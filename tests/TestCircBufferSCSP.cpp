@@ -1,31 +1,42 @@
 #include "../src/CircBufferSCSP.h"
 
 #include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
 #include <thread>
+#include <unistd.h>
 #include <utility>
 #include "../src/TestAssert.h"
 
 
-struct B : sharemind::CircBufferSCSP<char> {
+template <typename Buffer>
+struct B : Buffer {
+    using ValueType = typename Buffer::ValueType;
     B(std::size_t fullSize, std::size_t filledSize)
-        : sharemind::CircBufferSCSP<char>(fullSize)
+        : Buffer(fullSize)
     {
         SHAREMIND_TESTASSERT(filledSize <= fullSize);
         ValueType elem = 0;
         while (filledSize--) {
-            write(&elem, 1u);
+            this->write(&elem, 1u);
             ++elem;
         }
     }
 };
 
-template <std::size_t SIZE,
+template <typename Buffer,
+          std::size_t SIZE,
           std::size_t FILL_A,
           std::size_t FILL_B,
           std::size_t ITERS,
           typename Worker>
 void testWithActors(Worker worker) {
+    using B = ::B<Buffer>;
     static_assert(FILL_A <= SIZE, "");
     static_assert(FILL_B <= SIZE, "");
     static_assert((FILL_A < SIZE) || (FILL_B < SIZE), "");
@@ -49,8 +60,8 @@ void testWithActors(Worker worker) {
                 auto s = a_.dataAvailable();
                 SHAREMIND_TESTASSERT(s == b_.dataAvailable());
                 for (; s; --s) {
-                    B::ValueType v1{};
-                    B::ValueType v2{};
+                    typename B::ValueType v1{};
+                    typename B::ValueType v2{};
                     a_.read(&v1, 1u);
                     b_.read(&v2, 1u);
                     SHAREMIND_TESTASSERT(v1 == v2);
@@ -61,7 +72,10 @@ void testWithActors(Worker worker) {
 }
 
 #define WORKER(rw,tf,wr,ft,c,...) \
-        [](std::atomic<bool> & startSignal, B & from, B & to) noexcept { \
+        [](std::atomic<bool> & startSignal, \
+           B<Buffer> & from, \
+           B<Buffer> & to) \
+                noexcept { \
             auto toMove = (FILL_A + FILL_B) * ITERS; \
             while (!startSignal.load(std::memory_order_acquire)) {}; \
             do { \
@@ -94,61 +108,300 @@ void testWithActors(Worker worker) {
             } while (toMove); \
         }
 
-template <std::size_t SIZE,
+template <typename Buffer,
+          std::size_t SIZE,
           std::size_t FILL_A,
           std::size_t FILL_B,
           std::size_t ITERS>
 inline void testNoStep() {
-    testWithActors<SIZE, FILL_A, FILL_B, ITERS>(
+    testWithActors<Buffer, SIZE, FILL_A, FILL_B, ITERS>(
                 WORKER(read,  from, write, to,,));
-    testWithActors<SIZE, FILL_A, FILL_B, ITERS>(
+    testWithActors<Buffer, SIZE, FILL_A, FILL_B, ITERS>(
                 WORKER(write, to,   read,  from, const,));
 }
 
-template <std::size_t SIZE,
+template <typename Buffer,
+          std::size_t SIZE,
           std::size_t FILL_A,
           std::size_t FILL_B,
           std::size_t ITERS,
           std::size_t STEP>
 inline void test() {
-    testNoStep<SIZE, FILL_A, FILL_B, ITERS>();
-    testWithActors<SIZE, FILL_A, FILL_B, ITERS>(
+    testNoStep<Buffer, SIZE, FILL_A, FILL_B, ITERS>();
+    testWithActors<Buffer, SIZE, FILL_A, FILL_B, ITERS>(
                 WORKER(read,  from, write, to,,
                        if (size > STEP) size = STEP;));
-    testWithActors<SIZE, FILL_A, FILL_B, ITERS>(
+    testWithActors<Buffer, SIZE, FILL_A, FILL_B, ITERS>(
                 WORKER(write, to,   read,  from, const,
                        if (size > STEP) size = STEP;));
 }
 
+template <typename Buffer>
+void testBuffer() {
+    testNoStep<Buffer, 1u, 0u, 1u, 1000u>();
+    test<Buffer, 10u, 0u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 1u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 2u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 3u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 4u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 5u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 6u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 7u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 8u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 9u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 10u, 5u, 1000u, 3u>();
+    test<Buffer, 10u, 10u, 5u, 1000u, 7u>();
+    test<Buffer, 10u, 0u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 1u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 2u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 3u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 4u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 5u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 6u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 7u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 8u, 10u, 1000u, 3u>();
+    test<Buffer, 10u, 9u, 10u, 1000u, 3u>();
+    test<Buffer, 100u, 0u, 1u, 1000u, 3u>();
+    test<Buffer, 100u, 0u, 10u, 1000u, 3u>();
+    test<Buffer, 100u, 5u, 10u, 1000u, 3u>();
+    test<Buffer, 100u, 13u, 50u, 1000u, 17u>();
+    test<Buffer, 100u, 50u, 50u, 1000u, 29u>();
+    test<Buffer, 100u, 77u, 50u, 1000u, 29u>();
+    test<Buffer, 100u, 100u, 50u, 1000u, 3u>();
+}
+
+/* The returned bounds hold also when mixed with dataAvailable() and
+   spaceAvailable(), which bypass any cached state: */
+template <typename Buffer>
+void testBoundsWithPublicQueries() {
+    Buffer b(16u);
+    SHAREMIND_TESTASSERT(b.bufferSize() == 16u);
+    SHAREMIND_TESTASSERT(b.haveWritten(10u) == 6u);
+    SHAREMIND_TESTASSERT(b.dataAvailable() == 10u);
+    SHAREMIND_TESTASSERT(b.haveRead(10u) == 0u);
+    SHAREMIND_TESTASSERT(b.empty());
+    SHAREMIND_TESTASSERT(b.spaceAvailable() == 16u);
+    SHAREMIND_TESTASSERT(b.haveWritten(12u) <= 4u);
+    SHAREMIND_TESTASSERT(b.haveWrittenRetUbe(4u) == 0u);
+    SHAREMIND_TESTASSERT(b.full());
+    SHAREMIND_TESTASSERT(b.dataAvailable() == 16u);
+    SHAREMIND_TESTASSERT(b.haveReadRetUbe(6u) <= 10u);
+    SHAREMIND_TESTASSERT(b.haveReadRetUbe(10u) == 0u);
+    SHAREMIND_TESTASSERT(b.empty());
+
+    for (std::size_t i = 0u; i < 1000u; ++i) {
+        auto const w = (i * 7u) % (b.spaceAvailable() + 1u);
+        auto const space =
+                (i % 2u) ? b.haveWrittenRetUbe(w) : b.haveWritten(w);
+        SHAREMIND_TESTASSERT(space <= b.spaceAvailable());
+        auto const r = (i * 5u) % (b.dataAvailable() + 1u);
+        auto const data = (i % 3u) ? b.haveRead(r) : b.haveReadRetUbe(r);
+        SHAREMIND_TESTASSERT(data <= b.dataAvailable());
+    }
+}
+
+void testMirrored() {
+    using Buffer =
+            sharemind::CircBufferSCSP<
+                char,
+                sharemind::CircBufferScspLockFree,
+                sharemind::CircBufferMirroredStorage<char> >;
+    static_assert(Buffer::isMirrored, "");
+    Buffer b(10u);
+    auto const size = b.bufferSize();
+    SHAREMIND_TESTASSERT(size >= 10u);
+    SHAREMIND_TESTASSERT(b.spaceAvailableUntilBufferEnd() == size);
+
+    // Both halves of the mapping alias each other:
+    char * const start = b.arrayStart();
+    start[0u] = 'x';
+    SHAREMIND_TESTASSERT(start[size] == 'x');
+    start[size + 1u] = 'y';
+    SHAREMIND_TESTASSERT(start[1u] == 'y');
+
+    // Move the offsets close to the end of the buffer:
+    b.haveWritten(size - 3u);
+    b.haveRead(size - 3u);
+    SHAREMIND_TESTASSERT(b.writeOffset() == size - 3u);
+    SHAREMIND_TESTASSERT(b.spaceAvailable() == size);
+
+    // Write across the end of the buffer, which should be contiguous:
+    char const data[] = "0123456789";
+    SHAREMIND_TESTASSERT(b.write(data, 10u) == 10u);
+    SHAREMIND_TESTASSERT(b.writeOffset() == 7u);
+    SHAREMIND_TESTASSERT(b.dataAvailableUntilBufferEnd() == 10u);
+    char const * const readPtr = b.arrayStart() + b.readOffset();
+    for (unsigned i = 0u; i < 10u; ++i)
+        SHAREMIND_TESTASSERT(readPtr[i] == data[i]);
+
+    char out[10u];
+    SHAREMIND_TESTASSERT(b.read(out, 10u) == 10u);
+    for (unsigned i = 0u; i < 10u; ++i)
+        SHAREMIND_TESTASSERT(out[i] == data[i]);
+    SHAREMIND_TESTASSERT(b.readOffset() == 7u);
+    SHAREMIND_TESTASSERT(b.empty());
+}
+
+template <typename Buffer>
+void testFd() {
+    int fds[2u];
+    SHAREMIND_TESTASSERT(::pipe(fds) == 0);
+    char const data[] = "0123456789";
+
+    Buffer b(16u);
+    auto const size = b.bufferSize();
+    SHAREMIND_TESTASSERT(size >= 16u);
+
+    // Nothing to write:
+    SHAREMIND_TESTASSERT(b.writeToFd(fds[1u]) == 0u);
+
+    // Move the offsets close to the end of the buffer:
+    b.haveWritten(size - 3u);
+    b.haveRead(size - 3u);
+
+    // Read across the end of the buffer:
+    SHAREMIND_TESTASSERT(::write(fds[1u], data, 10u) == 10);
+    SHAREMIND_TESTASSERT(b.readFromFd(fds[0u]) == 10u);
+    SHAREMIND_TESTASSERT(b.dataAvailable() == 10u);
+    SHAREMIND_TESTASSERT(b.writeOffset() == 7u);
+
+    // Write across the end of the buffer:
+    SHAREMIND_TESTASSERT(b.writeToFd(fds[1u]) == 10u);
+    SHAREMIND_TESTASSERT(b.empty());
+    SHAREMIND_TESTASSERT(b.readOffset() == 7u);
+    char out[10u];
+    SHAREMIND_TESTASSERT(::read(fds[0u], out, 10u) == 10);
+    SHAREMIND_TESTASSERT(std::memcmp(out, data, 10u) == 0);
+
+    // Non-blocking file descriptors which are not ready:
+    sharemind::fcntlAddFl<std::exception>(fds[0u], O_NONBLOCK);
+    sharemind::fcntlAddFl<std::exception>(fds[1u], O_NONBLOCK);
+    SHAREMIND_TESTASSERT(b.readFromFd(fds[0u]) == 0u);
+    SHAREMIND_TESTASSERT(b.empty());
+    std::size_t piped = 0u;
+    for (;;) { // Fill the pipe
+        auto const r(::write(fds[1u], out, sizeof(out)));
+        if (r < 0)
+            break;
+        piped += static_cast<std::size_t>(r);
+    }
+    SHAREMIND_TESTASSERT(b.write(data, 10u) == 10u);
+    SHAREMIND_TESTASSERT(b.writeToFd(fds[1u]) == 0u);
+    SHAREMIND_TESTASSERT(b.dataAvailable() == 10u);
+    for (; piped; piped -= sizeof(out))
+        SHAREMIND_TESTASSERT(::read(fds[0u], out, sizeof(out))
+                             == static_cast<::ssize_t>(sizeof(out)));
+
+    // Reading at end-of-file:
+    SHAREMIND_TESTASSERT(::close(fds[1u]) == 0);
+    try {
+        b.readFromFd(fds[0u]);
+        SHAREMIND_TESTASSERT(false);
+    } catch (typename Buffer::EndOfFileException const &) {}
+    SHAREMIND_TESTASSERT(::close(fds[0u]) == 0);
+
+    // Non-blocking socket closed by the peer after sending some data:
+    SHAREMIND_TESTASSERT(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    sharemind::fcntlAddFl<std::exception>(fds[0u], O_NONBLOCK);
+    SHAREMIND_TESTASSERT(b.readFromFd(fds[0u]) == 0u);
+    SHAREMIND_TESTASSERT(::write(fds[1u], data, 5u) == 5);
+    SHAREMIND_TESTASSERT(::close(fds[1u]) == 0);
+    SHAREMIND_TESTASSERT(b.readFromFd(fds[0u]) == 5u);
+    SHAREMIND_TESTASSERT(b.dataAvailable() == 15u);
+    try {
+        b.readFromFd(fds[0u]);
+        SHAREMIND_TESTASSERT(false);
+    } catch (typename Buffer::EndOfFileException const &) {}
+    // A full buffer is reported as such even at end-of-file:
+    b.haveWritten(b.spaceAvailable());
+    SHAREMIND_TESTASSERT(b.readFromFd(fds[0u]) == 0u);
+    SHAREMIND_TESTASSERT(::close(fds[0u]) == 0);
+}
+
+template <typename Buffer>
+void testCancellableWaits() {
+    using S = sharemind::CircBufferWaitStatus;
+    using namespace std::chrono_literals;
+    Buffer b(4u);
+    SHAREMIND_TESTASSERT(b.waitDataAvailableFor(1ms) == S::Timeout);
+    SHAREMIND_TESTASSERT(b.waitSpaceAvailableFor(1ms) == S::Ready);
+    SHAREMIND_TESTASSERT(
+                b.waitDataAvailableUntil(std::chrono::steady_clock::now())
+                == S::Timeout);
+
+    sharemind::CancellationSource cancelled;
+    cancelled.cancel();
+    SHAREMIND_TESTASSERT(b.waitDataAvailableFor(1h, cancelled.token())
+                         == S::Cancelled);
+    try {
+        b.waitDataAvailable(cancelled.token());
+        SHAREMIND_TEST_UNREACHABLE;
+    } catch (sharemind::CancelledException const &) {}
+
+    { // Woken up by data:
+        sharemind::CancellationSource source;
+        std::thread t([&b]() noexcept {
+                          char const c = 'x';
+                          std::this_thread::sleep_for(10ms);
+                          b.write(&c, 1u);
+                      });
+        SHAREMIND_TESTASSERT(b.waitDataAvailableFor(1h, source.token())
+                             == S::Ready);
+        t.join();
+        SHAREMIND_TESTASSERT(b.waitDataAvailable(source.token()) == 1u);
+    }
+
+    // Fill the buffer:
+    char const data[] = "abcd";
+    b.write(data, b.spaceAvailable());
+    SHAREMIND_TESTASSERT(b.full());
+    SHAREMIND_TESTASSERT(b.waitSpaceAvailableFor(1ms) == S::Timeout);
+
+    { // Woken up by cancellation:
+        sharemind::CancellationSource source;
+        std::thread t([&source]() noexcept {
+                          std::this_thread::sleep_for(10ms);
+                          source.cancel();
+                      });
+        try {
+            b.waitSpaceAvailable(source.token());
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (sharemind::CancelledException const &) {}
+        t.join();
+    }{
+        sharemind::CancellationSource source;
+        std::thread t([&source]() noexcept {
+                          std::this_thread::sleep_for(10ms);
+                          source.cancel();
+                      });
+        SHAREMIND_TESTASSERT(b.waitSpaceAvailableFor(1h, source.token())
+                             == S::Cancelled);
+        t.join();
+    }
+}
+
 int main() {
-    testNoStep<1u, 0u, 1u, 1000u>();
-    test<10u, 0u, 5u, 1000u, 3u>();
-    test<10u, 1u, 5u, 1000u, 3u>();
-    test<10u, 2u, 5u, 1000u, 3u>();
-    test<10u, 3u, 5u, 1000u, 3u>();
-    test<10u, 4u, 5u, 1000u, 3u>();
-    test<10u, 5u, 5u, 1000u, 3u>();
-    test<10u, 6u, 5u, 1000u, 3u>();
-    test<10u, 7u, 5u, 1000u, 3u>();
-    test<10u, 8u, 5u, 1000u, 3u>();
-    test<10u, 9u, 5u, 1000u, 3u>();
-    test<10u, 10u, 5u, 1000u, 3u>();
-    test<10u, 10u, 5u, 1000u, 7u>();
-    test<10u, 0u, 10u, 1000u, 3u>();
-    test<10u, 1u, 10u, 1000u, 3u>();
-    test<10u, 2u, 10u, 1000u, 3u>();
-    test<10u, 3u, 10u, 1000u, 3u>();
-    test<10u, 4u, 10u, 1000u, 3u>();
-    test<10u, 5u, 10u, 1000u, 3u>();
-    test<10u, 6u, 10u, 1000u, 3u>();
-    test<10u, 7u, 10u, 1000u, 3u>();
-    test<10u, 8u, 10u, 1000u, 3u>();
-    test<10u, 9u, 10u, 1000u, 3u>();
-    test<100u, 0u, 1u, 1000u, 3u>();
-    test<100u, 0u, 10u, 1000u, 3u>();
-    test<100u, 5u, 10u, 1000u, 3u>();
-    test<100u, 13u, 50u, 1000u, 17u>();
-    test<100u, 50u, 50u, 1000u, 29u>();
-    test<100u, 77u, 50u, 1000u, 29u>();
-    test<100u, 100u, 50u, 1000u, 3u>();
+    using sharemind::CircBufferSCSP;
+    using sharemind::CircBufferScspLocking;
+    using sharemind::CircBufferScspLockFree;
+    using sharemind::CircBufferMirroredStorage;
+    testBuffer<CircBufferSCSP<char, CircBufferScspLocking<> > >();
+    testBuffer<CircBufferSCSP<char, CircBufferScspLockFree> >();
+    testBuffer<CircBufferSCSP<char,
+                              CircBufferScspLocking<>,
+                              CircBufferMirroredStorage<char> > >();
+    testBuffer<CircBufferSCSP<char,
+                              CircBufferScspLockFree,
+                              CircBufferMirroredStorage<char> > >();
+    testBoundsWithPublicQueries<CircBufferSCSP<char,
+                                               CircBufferScspLocking<> > >();
+    testBoundsWithPublicQueries<CircBufferSCSP<char,
+                                               CircBufferScspLockFree> >();
+    testMirrored();
+    testCancellableWaits<CircBufferSCSP<char, CircBufferScspLocking<> > >();
+    testCancellableWaits<CircBufferSCSP<char, CircBufferScspLockFree> >();
+    testFd<CircBufferSCSP<char> >();
+    testFd<CircBufferSCSP<char,
+                          CircBufferScspLockFree,
+                          CircBufferMirroredStorage<char> > >();
 }
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/ConcurrentLRU.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+struct Elem { std::size_t value; };
+
+int main() {
+    using sharemind::ConcurrentLRU;
+
+    { // Retention semantics, with a single shard:
+        ConcurrentLRU<std::string, Elem> lru(1u, 1u);
+        SHAREMIND_TESTASSERT(lru.numShards() == 1u);
+        auto elem1 = std::make_shared<Elem>();
+        auto elem2 = std::make_shared<Elem>();
+        lru.insert("key1", elem1);
+        SHAREMIND_TESTASSERT(elem1.use_count() == 2);
+        SHAREMIND_TESTASSERT(lru.get("key1") == elem1);
+        lru.insert("key2", elem2);
+        SHAREMIND_TESTASSERT(elem2.use_count() == 2);
+        // elem1 is only weakly referenced by the cache
+        SHAREMIND_TESTASSERT(elem1.use_count() == 1);
+        // Promote elem1, which evicts elem2:
+        SHAREMIND_TESTASSERT(lru.get("key1") == elem1);
+        SHAREMIND_TESTASSERT(elem1.use_count() == 2);
+        SHAREMIND_TESTASSERT(elem2.use_count() == 1);
+        elem2 = std::make_shared<Elem>();
+        // Expired weak element:
+        SHAREMIND_TESTASSERT(lru.get("key2") == nullptr);
+        SHAREMIND_TESTASSERT(lru.size() == 1u);
+        // Overwrite:
+        lru.insert("key1", elem2);
+        SHAREMIND_TESTASSERT(elem1.use_count() == 1);
+        SHAREMIND_TESTASSERT(elem2.use_count() == 2);
+        lru.erase("key1");
+        SHAREMIND_TESTASSERT(elem2.use_count() == 1);
+        SHAREMIND_TESTASSERT(!lru.get("key1"));
+        lru.insert("key1", elem1);
+        lru.clear();
+        SHAREMIND_TESTASSERT(elem1.use_count() == 1);
+        SHAREMIND_TESTASSERT(lru.size() == 0u);
+    }{ // Recently referenced items survive eviction:
+        ConcurrentLRU<std::size_t, Elem> lru(4u, 1u);
+        for (std::size_t i = 0u; i < 4u; ++i)
+            lru.insert(i, std::make_shared<Elem>());
+        // Let the clock hand pass all items once, clearing reference bits:
+        lru.insert(4u, std::make_shared<Elem>());
+        SHAREMIND_TESTASSERT(!lru.get(0u));
+        SHAREMIND_TESTASSERT(lru.get(1u));
+        lru.insert(5u, std::make_shared<Elem>());
+        SHAREMIND_TESTASSERT(lru.get(1u));
+        SHAREMIND_TESTASSERT(!lru.get(2u));
+    }{ // Expired weak items are reclaimed without being looked up:
+        ConcurrentLRU<std::size_t, Elem> lru(16u, 4u);
+        for (std::size_t i = 0u; i < 10000u; ++i)
+            lru.insert(i, std::make_shared<Elem>());
+        SHAREMIND_TESTASSERT(lru.size() <= 16u + 4u * 2u);
+    }{ // The shard limits add up to the total limit:
+        for (std::size_t const limit : {1u, 3u, 16u, 37u, 100u}) {
+            ConcurrentLRU<std::size_t, Elem> lru(limit, 16u);
+            SHAREMIND_TESTASSERT(lru.numShards() <= limit);
+            std::vector<std::weak_ptr<Elem> > items;
+            for (std::size_t i = 0u; i < 10000u; ++i) {
+                auto item(std::make_shared<Elem>());
+                items.emplace_back(item);
+                lru.insert(i, std::move(item));
+            }
+            std::size_t alive = 0u;
+            for (auto const & item : items)
+                if (!item.expired())
+                    ++alive;
+            SHAREMIND_TESTASSERT(alive == limit);
+        }
+    }{ // Concurrent use:
+        constexpr std::size_t numThreads = 4u;
+        constexpr std::size_t numKeys = 64u;
+        ConcurrentLRU<std::size_t, Elem> lru(32u, 4u);
+        std::atomic<bool> failed(false);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0u; t < numThreads; ++t)
+            threads.emplace_back(
+                        [&lru, &failed, t]() {
+                            for (std::size_t i = 0u; i < 5000u; ++i) {
+                                auto const key = (i * 7u + t) % numKeys;
+                                if (auto const v = lru.get(key)) {
+                                    if (v->value != key)
+                                        failed = true;
+                                } else {
+                                    lru.insert(key,
+                                               std::make_shared<Elem>(
+                                                   Elem{key}));
+                                }
+                                if (!(i % 100u))
+                                    lru.erase((key + 1u) % numKeys);
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(!failed);
+        SHAREMIND_TESTASSERT(lru.size() <= numKeys);
+    }
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/FlatUnorderedMap.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "../src/StringHasher.h"
+#include "../src/StringHashTablePredicate.h"
+#include "../src/TestAssert.h"
+
+
+namespace {
+
+/* A poor hash, so that many keys share control bytes and probe groups: */
+struct CollidingHash {
+    std::size_t operator()(unsigned const v) const noexcept
+    { return v % 37u; }
+};
+
+struct MyHash {
+    std::size_t operator()(std::string const & v) const noexcept
+    { return std::hash<std::string>()(v) + 10u; }
+};
+
+struct MyKeyEqual {
+    static char const * ensureCString(std::string const & str) noexcept
+    { return str.c_str(); }
+
+    static char const * ensureCString(char const * const str) noexcept
+    { return str; }
+
+    template <typename A, typename B>
+    bool operator()(A && a, B && b) const noexcept {
+        return std::strcmp(ensureCString(std::forward<A>(a)),
+                           ensureCString(std::forward<B>(b))) == 0;
+    }
+};
+
+template <typename Map>
+void testAgainstReference(std::size_t const numOps, unsigned const keyRange) {
+    std::mt19937 rng(42u);
+    std::uniform_int_distribution<unsigned> keyDist(0u, keyRange);
+    std::uniform_int_distribution<unsigned> opDist(0u, 9u);
+
+    Map m;
+    std::unordered_map<unsigned, std::string> ref;
+    for (std::size_t op = 0u; op < numOps; ++op) {
+        auto const key(keyDist(rng));
+        auto const what(opDist(rng));
+        if (what < 4u) {
+            auto const r(m.emplace(key, std::to_string(key)));
+            auto const rr(ref.emplace(key, std::to_string(key)));
+            SHAREMIND_TESTASSERT(r.second == rr.second);
+            SHAREMIND_TESTASSERT(r.first->first == key);
+        } else if (what < 7u) {
+            SHAREMIND_TESTASSERT(m.erase(key) == ref.erase(key));
+        } else if (what < 8u) {
+            m[key] += "x";
+            ref[key] += "x";
+        } else {
+            auto const it(m.find(key));
+            auto const rit(ref.find(key));
+            SHAREMIND_TESTASSERT((it == m.end()) == (rit == ref.end()));
+            if (it != m.end())
+                SHAREMIND_TESTASSERT(it->second == rit->second);
+        }
+        SHAREMIND_TESTASSERT(m.size() == ref.size());
+        SHAREMIND_TESTASSERT(m.load_factor() <= m.max_load_factor());
+    }
+
+    std::size_t n = 0u;
+    for (auto const & v : m) {
+        auto const rit(ref.find(v.first));
+        SHAREMIND_TESTASSERT(rit != ref.end());
+        SHAREMIND_TESTASSERT(rit->second == v.second);
+        ++n;
+    }
+    SHAREMIND_TESTASSERT(n == ref.size());
+
+    // Erasing while iterating:
+    for (auto it = m.cbegin(); it != m.cend();) {
+        if (it->first % 2u) {
+            ref.erase(it->first);
+            it = m.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    SHAREMIND_TESTASSERT(m.size() == ref.size());
+    for (auto const & v : ref)
+        SHAREMIND_TESTASSERT(m.at(v.first) == v.second);
+}
+
+} // anonymous namespace
+
+int main() {
+    using sharemind::FlatUnorderedMap;
+
+    testAgainstReference<FlatUnorderedMap<unsigned, std::string> >(20000u,
+                                                                    3000u);
+    testAgainstReference<FlatUnorderedMap<unsigned,
+                                          std::string,
+                                          CollidingHash> >(5000u, 500u);
+
+    { // Basic operations:
+        FlatUnorderedMap<unsigned, std::string> m;
+        SHAREMIND_TESTASSERT(m.empty());
+        SHAREMIND_TESTASSERT(m.begin() == m.end());
+        SHAREMIND_TESTASSERT(m.find(1u) == m.end());
+        SHAREMIND_TESTASSERT(m.bucket_count() == 0u);
+        auto const r(m.insert({1u, "one"}));
+        SHAREMIND_TESTASSERT(r.second);
+        SHAREMIND_TESTASSERT(m.bucket_count() > 0u);
+        SHAREMIND_TESTASSERT(!m.insert({1u, "uno"}).second);
+        SHAREMIND_TESTASSERT(m.at(1u) == "one");
+        auto const r2(m.insert_or_assign(1u, "uno"));
+        SHAREMIND_TESTASSERT(!r2.second);
+        SHAREMIND_TESTASSERT(r2.first == r.first);
+        SHAREMIND_TESTASSERT(m.at(1u) == "uno");
+        SHAREMIND_TESTASSERT(m.insert_or_assign(2u, "two").second);
+        SHAREMIND_TESTASSERT(m.count(2u) == 1u);
+        SHAREMIND_TESTASSERT(m.contains(2u));
+        SHAREMIND_TESTASSERT(!m.contains(3u));
+        auto const er(m.equal_range(2u));
+        SHAREMIND_TESTASSERT(er.first != er.second);
+        SHAREMIND_TESTASSERT(std::next(er.first) == er.second);
+        try {
+            m.at(3u);
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (std::out_of_range const & e) {
+            SHAREMIND_TESTASSERT(std::strlen(e.what()) > 0u);
+        }
+
+        // Copy, move and comparison:
+        auto copy(m);
+        SHAREMIND_TESTASSERT(copy == m);
+        copy[1u] = "changed";
+        SHAREMIND_TESTASSERT(copy != m);
+        SHAREMIND_TESTASSERT(m.at(1u) == "uno");
+        auto moved(std::move(copy));
+        SHAREMIND_TESTASSERT(copy.empty());
+        SHAREMIND_TESTASSERT(moved.size() == 2u);
+        copy = moved;
+        SHAREMIND_TESTASSERT(copy == moved);
+        m = std::move(moved);
+        SHAREMIND_TESTASSERT(m == copy);
+        m.swap(moved);
+        SHAREMIND_TESTASSERT(m.empty());
+        SHAREMIND_TESTASSERT(moved == copy);
+        m = {{5u, "five"}, {6u, "six"}};
+        SHAREMIND_TESTASSERT(m.size() == 2u);
+        SHAREMIND_TESTASSERT(m.erase(m.begin(), m.end()) == m.end());
+        SHAREMIND_TESTASSERT(m.empty());
+
+        // Rehashing keeps elements:
+        m.reserve(1000u);
+        auto const buckets(m.bucket_count());
+        for (unsigned i = 0u; i < 1000u; ++i)
+            m.emplace(i, std::to_string(i));
+        SHAREMIND_TESTASSERT(m.bucket_count() == buckets);
+        m.max_load_factor(0.5f);
+        SHAREMIND_TESTASSERT(m.load_factor() <= 0.5f);
+        m.rehash(0u);
+        for (unsigned i = 0u; i < 1000u; ++i)
+            SHAREMIND_TESTASSERT(m.at(i) == std::to_string(i));
+        m.clear();
+        SHAREMIND_TESTASSERT(m.empty());
+        SHAREMIND_TESTASSERT(m.begin() == m.end());
+        m.rehash(0u);
+        SHAREMIND_TESTASSERT(m.bucket_count() == 0u);
+    }
+
+    { // Move-only values:
+        FlatUnorderedMap<int, std::unique_ptr<int> > m;
+        for (int i = 0; i < 100; ++i)
+            m.emplace(i, std::make_unique<int>(i));
+        for (int i = 0; i < 100; ++i)
+            SHAREMIND_TESTASSERT(*m.at(i) == i);
+    }
+
+    { // Emplacing copies of elements, also when the table has to grow:
+        FlatUnorderedMap<unsigned, std::string> m;
+        std::string const value(100u, 'x');
+        m.emplace(0u, value);
+        for (unsigned i = 1u; i < 200u; ++i) {
+            SHAREMIND_TESTASSERT(m.emplace(i, m.at(0u)).second);
+            SHAREMIND_TESTASSERT(m.at(i) == value);
+            m.insert_or_assign(i, m.at(0u));
+            SHAREMIND_TESTASSERT(m.at(i) == value);
+        }
+        FlatUnorderedMap<std::string, std::string> m2;
+        for (unsigned i = 0u; i < 200u; ++i) {
+            auto const key(std::to_string(i) + std::string(100u, 'k'));
+            auto const r(m2.emplace(std::make_pair(key, value)));
+            SHAREMIND_TESTASSERT(r.second);
+            SHAREMIND_TESTASSERT(r.first->first == key);
+            if (i)
+                m2.emplace(key + "copy", m2.begin()->second);
+        }
+        for (auto const & v : m2)
+            SHAREMIND_TESTASSERT(v.second == value);
+    }
+
+    { // Explicit hash lookup:
+        char const cs[] = "teretere";
+        std::string const s(cs);
+        FlatUnorderedMap<std::string, int, MyHash> m;
+        auto const & cm = m;
+        m.emplace(s, 42);
+        auto const it(m.find(s));
+        SHAREMIND_TESTASSERT(it != m.end());
+        SHAREMIND_TESTASSERT(it->second == 42);
+        SHAREMIND_TESTASSERT(cm.find(cs) == it);
+
+        auto const hash(MyHash()(s));
+        SHAREMIND_TESTASSERT(m.find(hash, s) == it);
+        SHAREMIND_TESTASSERT(cm.find(hash, s) == it);
+        SHAREMIND_TESTASSERT(m.find(hash, MyKeyEqual(), cs) == it);
+        SHAREMIND_TESTASSERT(cm.find(hash, MyKeyEqual(), cs) == it);
+        SHAREMIND_TESTASSERT(m.contains(hash, MyKeyEqual(), cs));
+        SHAREMIND_TESTASSERT(
+                m.find(hash, [&s](std::string const & k) { return k == s; })
+                == it);
+        SHAREMIND_TESTASSERT(
+                !m.contains(hash + 1u,
+                            [&s](std::string const & k) { return k == s; }));
+
+        for (std::size_t i = 0u; i < 100u; ++i) {
+            auto const r(m.emplace(std::to_string(i) + "haha", i));
+            auto const & key = r.first->first;
+            auto const bucket(m.bucket(key));
+            SHAREMIND_TESTASSERT(bucket < m.bucket_count());
+            SHAREMIND_TESTASSERT(m.hash_bucket(MyHash()(key)) == bucket);
+            SHAREMIND_TESTASSERT(m.bucket(r.first) == bucket);
+        }
+        for (auto i = m.begin(); i != m.end(); ++i)
+            SHAREMIND_TESTASSERT(m.bucket(i) == m.bucket(i->first));
+    }
+
+    { // Transparent lookup:
+        FlatUnorderedMap<std::string, int, sharemind::StringHasher> m;
+        auto const & cm = m;
+        std::string const s("teretere");
+        m.emplace(s, 42);
+        auto const it(m.find(s));
+        SHAREMIND_TESTASSERT(it != m.end());
+        SHAREMIND_TESTASSERT(m.find("teretere") == it);
+        SHAREMIND_TESTASSERT(cm.contains("teretere"));
+        SHAREMIND_TESTASSERT(!cm.contains("tere"));
+
+        using sharemind::getOrCreateTemporaryStringHashTablePredicate;
+        auto const p(getOrCreateTemporaryStringHashTablePredicate(s));
+        SHAREMIND_TESTASSERT(m.find(p) == it);
+        SHAREMIND_TESTASSERT(m.find(p.hash(), p) == it);
+        SHAREMIND_TESTASSERT(cm.find(p) == it);
+        SHAREMIND_TESTASSERT(cm.count(p) == 1u);
+        SHAREMIND_TESTASSERT(m.erase("teretere") == 1u);
+        SHAREMIND_TESTASSERT(m.empty());
+    }
+}
@@ -19,17 +19,30 @@
 
 #include "../src/Future.h"
 
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <new>
+#include <string>
 #include <thread>
+#include <vector>
+#include "../src/SimpleThreadPool.h"
+#include "../src/Strand.h"
 #include "../src/TestAssert.h"
 
 
 using sharemind::BrokenPromiseException;
+using sharemind::CancellationSource;
+using sharemind::CancellationToken;
+using sharemind::CancelledException;
 using sharemind::Future;
 using sharemind::PackagedTask;
 using sharemind::Promise;
+using sharemind::SharedFuture;
+using sharemind::SimpleThreadPool;
+using sharemind::Strand;
 using sharemind::makeExceptionalFuture;
+using sharemind::makeReadyFuture;
 
 
 class DelayedThread: public std::thread {
@@ -88,6 +101,91 @@ public: /* Methods: */
 
 };
 
+class ManualExecutor {
+
+private: /* Types: */
+
+    struct TaskBase {
+        virtual ~TaskBase() noexcept {}
+        virtual void operator()() noexcept = 0;
+    };
+
+public: /* Methods: */
+
+    template <typename F>
+    void execute(F && f) {
+        struct Task final: TaskBase {
+            Task(F && f_) : m_f(std::forward<F>(f_)) {}
+            void operator()() noexcept final override { m_f(); }
+            typename std::decay<F>::type m_f;
+        };
+        m_tasks.emplace_back(new Task(std::forward<F>(f)));
+    }
+
+    std::size_t runAll() noexcept {
+        std::size_t r = 0u;
+        while (!m_tasks.empty()) {
+            auto task(std::move(m_tasks.front()));
+            m_tasks.erase(m_tasks.begin());
+            (*task)();
+            ++r;
+        }
+        return r;
+    }
+
+private: /* Fields: */
+
+    std::vector<std::unique_ptr<TaskBase> > m_tasks;
+
+};
+
+/** \brief An executor which schedules on a pool unless told to fail. */
+class FailingExecutor {
+
+public: /* Methods: */
+
+    FailingExecutor(SimpleThreadPool & pool) noexcept : m_pool(pool) {}
+
+    /** \note Leaves f untouched on failure, as ThreadPool::execute() does. */
+    template <typename F>
+    void execute(F && f) {
+        if (fail)
+            throw std::bad_alloc();
+        m_pool.execute(std::forward<F>(f));
+    }
+
+public: /* Fields: */
+
+    bool fail = false;
+
+private: /* Fields: */
+
+    SimpleThreadPool & m_pool;
+
+};
+
+std::size_t countingAllocatorAllocations = 0u;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+    CountingAllocator() noexcept {}
+    template <typename U>
+    CountingAllocator(CountingAllocator<U> const &) noexcept {}
+    T * allocate(std::size_t n) {
+        ++countingAllocatorAllocations;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T * p, std::size_t n) noexcept
+    { std::allocator<T>().deallocate(p, n); }
+};
+template <typename T, typename U>
+bool operator==(CountingAllocator<T> const &, CountingAllocator<U> const &)
+{ return true; }
+template <typename T, typename U>
+bool operator!=(CountingAllocator<T> const &, CountingAllocator<U> const &)
+{ return false; }
+
 struct E { int c; };
 struct V { int v; };
 
@@ -429,6 +527,219 @@ int main() {
         }
     }
 
+    { // Custom allocator for the shared state:
+        Promise<V> p(std::allocator_arg, CountingAllocator<V>());
+        SHAREMIND_TESTASSERT(countingAllocatorAllocations == 1u);
+        auto f(p.takeFuture());
+        p.setValue(V{42});
+        SHAREMIND_TESTASSERT(f.takeValue().v == 42);
+    }{ // Continuations chained on an abandoned promise:
+        auto pp(std::make_unique<Promise<V> >());
+        auto f(pp->takeFuture()
+                   .then([](Future<V> fut) { return fut.takeValue(); })
+                   .then([](Future<V> fut) { return fut.takeValue().v; }));
+        SHAREMIND_TESTASSERT(!f.isReady());
+        pp.reset();
+        SHAREMIND_TESTASSERT(f.isReady());
+        try {
+            f.takeValue();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (BrokenPromiseException const &) {}
+    }{ // Dropping the future of the continuation:
+        Promise<V> p;
+        bool ran = false;
+        p.takeFuture().then([&ran](Future<V> fut)
+                            { ran = (fut.takeValue().v == 42); });
+        p.setValue(V{42});
+        SHAREMIND_TESTASSERT(ran);
+    }
+
+    { // Shared futures:
+        Promise<std::string> p;
+        SharedFuture<std::string> sf(p.takeFuture().share());
+        auto sf2(sf);
+        SHAREMIND_TESTASSERT(sf.isValid());
+        SHAREMIND_TESTASSERT(!sf2.isReady());
+        std::atomic<unsigned> ran{0u};
+        std::vector<Future<std::size_t> > futures;
+        for (unsigned i = 0u; i < 10u; ++i)
+            futures.emplace_back(
+                        sf.then(
+                            [&ran, i](SharedFuture<std::string> f) {
+                                SHAREMIND_TESTASSERT(ran++ == i);
+                                return f.get().size();
+                            }));
+        SHAREMIND_TESTASSERT(ran == 0u);
+        p.setValue(std::string("forty-two"));
+        SHAREMIND_TESTASSERT(ran == 10u);
+        SHAREMIND_TESTASSERT(sf.get() == "forty-two");
+        SHAREMIND_TESTASSERT(&sf.get() == &sf2.get());
+        for (auto & f : futures)
+            SHAREMIND_TESTASSERT(f.takeValue() == 9u);
+        // Continuations attached after the value is set run immediately:
+        SHAREMIND_TESTASSERT(
+                sf2.then([](SharedFuture<std::string> const & f)
+                         { return f.get(); }).takeValue() == "forty-two");
+    }{
+        auto pp(std::make_shared<Promise<void> >());
+        SharedFuture<void> sf(pp->takeFuture());
+        std::atomic<unsigned> ran{0u};
+        std::vector<std::thread> threads;
+        for (unsigned i = 0u; i < 4u; ++i)
+            threads.emplace_back(
+                    [&ran, sf]() {
+                        for (unsigned j = 0u; j < 1000u; ++j)
+                            sf.then([&ran](SharedFuture<void> f) {
+                                           ++ran;
+                                           f.get();
+                                       });
+                    });
+        pp->setException(E{42});
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(ran == 4000u);
+        try {
+            sf.get();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (E const & e) {
+            SHAREMIND_TESTASSERT(e.c == 42);
+        }
+    }
+
+    { // Cancellation:
+        SHAREMIND_TESTASSERT(!CancellationToken().canBeCancelled());
+        SHAREMIND_TESTASSERT(!CancellationToken().isCancelled());
+        CancellationSource source;
+        auto const token(source.token());
+        SHAREMIND_TESTASSERT(token.canBeCancelled());
+        SHAREMIND_TESTASSERT(!token.isCancelled());
+
+        bool ran1 = false;
+        bool ran2 = false;
+        PackagedTask<V(V)> task(token,
+                                [&ran1](V v) {
+                                    ran1 = true;
+                                    return v;
+                                });
+        auto f(task.takeFuture());
+        SHAREMIND_TESTASSERT(f.cancellationToken().isCancelled() == false);
+        auto f2(f.then([&ran2](Future<V> fut) {
+                           ran2 = true;
+                           return fut.takeValue().v;
+                       }));
+        SHAREMIND_TESTASSERT(f2.cancellationToken().canBeCancelled());
+        source.cancel();
+        SHAREMIND_TESTASSERT(token.isCancelled());
+        SHAREMIND_TESTASSERT(f2.cancellationToken().isCancelled());
+        task(V{42});
+        SHAREMIND_TESTASSERT(!ran1);
+        SHAREMIND_TESTASSERT(!ran2);
+        try {
+            f2.takeValue();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (CancelledException const &) {}
+    }{
+        CancellationSource source;
+        Promise<V> p(source.token());
+        bool ran = false;
+        auto f(p.takeFuture().then([&ran](Future<V> fut) {
+                                       ran = true;
+                                       return fut.takeValue().v;
+                                   }));
+        p.setValue(V{42}); // Not cancelled
+        SHAREMIND_TESTASSERT(ran);
+        SHAREMIND_TESTASSERT(f.takeValue() == 42);
+    }{ // Cancellation callbacks:
+        CancellationSource source;
+        unsigned calls = 0u;
+        auto const f = [&calls]() noexcept { ++calls; };
+        using CB = sharemind::CancellationCallback<decltype(f)>;
+        {
+            CB const unregistered(source.token(), f);
+        }
+        {
+            CB const noToken(CancellationToken(), f);
+            CB const cb1(source.token(), f);
+            CB const cb2(source.token(), f);
+            SHAREMIND_TESTASSERT(calls == 0u);
+            source.cancel();
+            SHAREMIND_TESTASSERT(calls == 2u);
+            source.cancel(); // Callbacks are only invoked once
+            SHAREMIND_TESTASSERT(calls == 2u);
+        }
+        CB const late(source.token(), f); // Invoked immediately
+        SHAREMIND_TESTASSERT(calls == 3u);
+    }
+
+    { // .then() on an executor:
+        ManualExecutor executor;
+        Promise<V> p;
+        bool ran = false;
+        auto f = p.takeFuture().then(executor,
+                                     [&ran](Future<V> fut) {
+                                         ran = true;
+                                         return fut.takeValue().v + 1;
+                                     });
+        static_assert(std::is_same<decltype(f), Future<int> >::value, "");
+        SHAREMIND_TESTASSERT(executor.runAll() == 0u);
+        p.setValue(V{41});
+        SHAREMIND_TESTASSERT(!ran);
+        SHAREMIND_TESTASSERT(!f.isReady());
+        SHAREMIND_TESTASSERT(executor.runAll() == 1u);
+        SHAREMIND_TESTASSERT(ran);
+        SHAREMIND_TESTASSERT(f.takeValue() == 42);
+    }{
+        auto const poolPtr(std::make_shared<SimpleThreadPool>(2u));
+        auto & pool = *poolPtr;
+        Strand strand(poolPtr);
+        SHAREMIND_TESTASSERT(!pool.runningInThisThread());
+        SHAREMIND_TESTASSERT(!strand.runningInThisThread());
+        auto pp = std::make_shared<Promise<void> >();
+        auto f =
+                pp->takeFuture().then(
+                    pool,
+                    [&pool](Future<void> fut) {
+                        fut.takeValue();
+                        SHAREMIND_TESTASSERT(pool.runningInThisThread());
+                        return makeReadyFuture(V{42});
+                    }).then(
+                        pool,
+                        [&pool](Future<V> fut) {
+                            // Already on the pool, no rescheduling needed:
+                            SHAREMIND_TESTASSERT(pool.runningInThisThread());
+                            return fut.takeValue();
+                        }).then(
+                            strand,
+                            [&strand](Future<V> fut) {
+                                SHAREMIND_TESTASSERT(
+                                            strand.runningInThisThread());
+                                return fut.takeValue().v;
+                            });
+        SetReadyDelayedThread(std::move(pp));
+        SHAREMIND_TESTASSERT(f.takeValue() == 42);
+    }
+    /* Continuations run inline when scheduling fails, and on the executor
+       otherwise: */
+    for (bool const fail : {true, false}) {
+        SimpleThreadPool pool(1u);
+        FailingExecutor executor(pool);
+        executor.fail = fail;
+        Promise<V> p;
+        bool inline_ = false;
+        auto const self(std::this_thread::get_id());
+        auto f = p.takeFuture().then(
+                    executor,
+                    [&inline_, self](Future<V> fut) {
+                        inline_ = (std::this_thread::get_id() == self);
+                        return fut.takeValue().v + 1;
+                    });
+        p.setValue(V{41});
+        if (fail)
+            SHAREMIND_TESTASSERT(f.isReady());
+        SHAREMIND_TESTASSERT(f.takeValue() == 42);
+        SHAREMIND_TESTASSERT(inline_ == fail);
+    }
+
     using PT = PackagedTask<V(V,V)>;
     static_assert(std::is_default_constructible<PT>::value, "");
     static_assert(!std::is_copy_constructible<PT>::value, "");
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/Future.h"
+
+#include "../src/TestAssert.h"
+
+#ifdef SHAREMIND_FUTURE_HAVE_COROUTINES
+#include <memory>
+#include <thread>
+#include "../src/SimpleThreadPool.h"
+
+
+using sharemind::Future;
+using sharemind::Promise;
+using sharemind::SimpleThreadPool;
+using sharemind::makeExceptionalFuture;
+using sharemind::makeReadyFuture;
+using sharemind::resumeOn;
+
+namespace {
+
+struct E {};
+
+Future<void> nop() { co_return; }
+
+Future<int> addOne(Future<int> f) { co_return (co_await std::move(f)) + 1; }
+
+Future<int> sum(Future<int> a, Future<int> b) {
+    co_await nop();
+    int const x = co_await std::move(a);
+    int const y = co_await std::move(b);
+    co_return x + y;
+}
+
+Future<int> throwing(Future<void> f) {
+    co_await std::move(f);
+    throw E();
+}
+
+Future<bool> onPool(SimpleThreadPool & pool, Future<int> f) {
+    int const v = co_await resumeOn(pool, std::move(f));
+    co_return (v == 42) && pool.runningInThisThread();
+}
+
+} // anonymous namespace
+
+int main() {
+    SHAREMIND_TESTASSERT(addOne(makeReadyFuture(41)).takeValue() == 42);
+    {
+        Promise<int> p1;
+        Promise<int> p2;
+        auto f(sum(addOne(p1.takeFuture()), p2.takeFuture()));
+        SHAREMIND_TESTASSERT(!f.isReady());
+        p2.setValue(2);
+        SHAREMIND_TESTASSERT(!f.isReady());
+        p1.setValue(39);
+        SHAREMIND_TESTASSERT(f.isReady());
+        SHAREMIND_TESTASSERT(f.takeValue() == 42);
+    }{
+        auto f(throwing(makeReadyFuture()));
+        try {
+            f.takeValue();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (E const &) {}
+        f = addOne(makeExceptionalFuture<int>(E()));
+        try {
+            f.takeValue();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (E const &) {}
+    }{
+        SimpleThreadPool pool(1u);
+        Promise<int> p;
+        auto f(onPool(pool, p.takeFuture()));
+        std::thread t([&p]() noexcept { p.setValue(42); });
+        SHAREMIND_TESTASSERT(f.takeValue());
+        t.join();
+    }
+}
+#else
+int main() {}
+#endif
@@ -20,12 +20,47 @@
 #include "../src/IdentifierPool.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
 #include <random>
 #include <memory>
+#include <set>
+#include <thread>
+#include <vector>
 #include "../src/StrongType.h"
 #include "../src/TestAssert.h"
 
 
+namespace {
+
+std::atomic<long> liveAllocations(0);
+std::atomic<long> totalAllocations(0);
+
+} // anonymous namespace
+
+void * operator new(std::size_t const size) {
+    if (void * const r = std::malloc(size ? size : 1u)) {
+        ++liveAllocations;
+        ++totalAllocations;
+        return r;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void * const ptr) noexcept {
+    if (ptr) {
+        --liveAllocations;
+        std::free(ptr);
+    }
+}
+
+void operator delete(void * const ptr, std::size_t) noexcept
+{ operator delete(ptr); }
+
 #define CHECK_INVARIANTS \
     do { /* O(n^2) complexity, but in-place and noexcept: */ \
         for (auto const & e1 : reserved) \
@@ -73,8 +108,150 @@ void test() {
     REMOVE(reserved.size());
 }
 
+template <typename T>
+void testExhaustion() {
+    constexpr std::size_t numIds =
+            std::size_t(std::numeric_limits<T>::max()) + 1u;
+    sharemind::IdentifierPool<T> pool;
+    std::vector<sharemind::IdHolder<T> > reserved;
+    reserved.reserve(numIds);
+    for (std::size_t i = 0u; i < numIds; ++i) {
+        reserved.emplace_back(pool.reserve());
+        // IDs are handed out in order until wraparound:
+        SHAREMIND_TESTASSERT(reserved.back().id() == i);
+    }
+    try {
+        pool.reserve();
+        SHAREMIND_TESTASSERT(false);
+    } catch (typename sharemind::IdentifierPool<T>::ReserveException const &)
+    {}
+    reserved[numIds / 3u].release();
+    reserved[numIds / 2u].release();
+    auto holder1(pool.reserve());
+    SHAREMIND_TESTASSERT(holder1.id() == numIds / 3u);
+    auto holder(pool.reserve()); // Reserves the next one after numIds / 3u
+    SHAREMIND_TESTASSERT(holder.id() == numIds / 2u);
+    try {
+        pool.reserve();
+        SHAREMIND_TESTASSERT(false);
+    } catch (typename sharemind::IdentifierPool<T>::ReserveException const &)
+    {}
+    reserved.clear();
+    holder1.release();
+    holder.release();
+    // Continues after the last reserved ID:
+    SHAREMIND_TESTASSERT(pool.reserve().id() == numIds / 2u + 1u);
+}
+
+void testBulkAndThreadCaches() {
+    using Pool = sharemind::IdentifierPool<unsigned char>;
+    { // reserveBulk():
+        Pool pool;
+        auto single(pool.reserve());
+        auto range(pool.reserveBulk(200u));
+        SHAREMIND_TESTASSERT(range.valid());
+        SHAREMIND_TESTASSERT(range.size() == 200u);
+        std::set<unsigned> ids(range.begin(), range.end());
+        ids.insert(single.id());
+        SHAREMIND_TESTASSERT(ids.size() == 201u);
+        try { // All or nothing:
+            pool.reserveBulk(100u);
+            SHAREMIND_TESTASSERT(false);
+        } catch (Pool::ReserveException const &) {}
+        auto range2(pool.reserveBulk(55u));
+        try {
+            pool.reserve();
+            SHAREMIND_TESTASSERT(false);
+        } catch (Pool::ReserveException const &) {}
+        range.release();
+        SHAREMIND_TESTASSERT(!range.valid());
+        SHAREMIND_TESTASSERT(pool.reserveBulk(200u).size() == 200u);
+    }{ // Thread caches:
+        constexpr std::size_t numThreads = 4u;
+        Pool pool(16u);
+        std::vector<sharemind::IdHolder<unsigned char> > held[numThreads];
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0u; t < numThreads; ++t)
+            threads.emplace_back(
+                        [&pool, &held, t]() {
+                            for (unsigned i = 0u; i < 1000u; ++i) {
+                                auto & h = held[t];
+                                h.emplace_back(pool.reserve());
+                                if (h.size() > 20u)
+                                    h.erase(h.begin(), h.begin() + 10);
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        // The caches of the exited threads were returned to the pool:
+        std::set<unsigned> ids;
+        for (auto const & h : held)
+            for (auto const & id : h)
+                ids.insert(id.id());
+        std::size_t numHeld = 0u;
+        for (auto const & h : held)
+            numHeld += h.size();
+        SHAREMIND_TESTASSERT(ids.size() == numHeld);
+        std::vector<sharemind::IdHolder<unsigned char> > rest;
+        try {
+            for (;;)
+                rest.emplace_back(pool.reserve());
+        } catch (Pool::ReserveException const &) {}
+        SHAREMIND_TESTASSERT(numHeld + rest.size() == 256u);
+    }{ // Thread caches of destroyed pools:
+        auto const fillCache =
+                [](Pool & pool) {
+                    std::vector<sharemind::IdHolder<unsigned char> > h;
+                    for (unsigned i = 0u; i < 10u; ++i)
+                        h.emplace_back(pool.reserve());
+                };
+        // Warm up the thread local cache map:
+        { Pool pool(16u); fillCache(pool); }
+        auto const allocationsBefore = liveAllocations.load();
+        for (unsigned i = 0u; i < 10000u; ++i) {
+            Pool pool(16u);
+            fillCache(pool);
+        }
+        // The caches do not keep the destroyed pools alive:
+        SHAREMIND_TESTASSERT(liveAllocations.load() - allocationsBefore < 100);
+
+        /* A new pool possibly at the address of a destroyed one does not
+           hand out IDs from the stale cache: */
+        for (unsigned i = 0u; i < 100u; ++i) {
+            { Pool pool(16u); fillCache(pool); }
+            Pool pool(16u);
+            std::vector<sharemind::IdHolder<unsigned char> > h;
+            std::set<unsigned> ids;
+            try {
+                for (;;) {
+                    h.emplace_back(pool.reserve());
+                    ids.insert(h.back().id());
+                }
+            } catch (Pool::ReserveException const &) {}
+            SHAREMIND_TESTASSERT(ids.size() == h.size());
+            SHAREMIND_TESTASSERT(h.size() == 256u);
+        }
+    }
+}
+
+void testNodeReuse() {
+    using Pool = sharemind::IdentifierPool<std::uint64_t>;
+    Pool pool;
+    pool.reserve();
+    auto const allocationsBefore = totalAllocations.load();
+    // Reserving and releasing IDs in an empty pool reuses the freed nodes:
+    for (unsigned i = 0u; i < 100000u; ++i)
+        pool.reserve();
+    SHAREMIND_TESTASSERT(totalAllocations.load() - allocationsBefore < 10);
+}
+
 int main() {
     test<unsigned>();
+    test<std::uint64_t>();
+    testExhaustion<unsigned char>();
+    testExhaustion<std::uint16_t>();
+    testBulkAndThreadCaches();
+    testNodeReuse();
 
     using UST =
             sharemind::StrongType<
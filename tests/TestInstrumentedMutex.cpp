@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#define SHAREMIND_INSTRUMENT_MUTEXES
+#include "../src/InstrumentedMutex.h"
+
+#include <cstddef>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "../src/CircBufferSCSP.h"
+#include "../src/TestAssert.h"
+#include "../src/TicketSpinLock.h"
+
+
+using sharemind::InstrumentedMutex;
+using sharemind::MutexStats;
+using sharemind::MutexStatsRegistry;
+
+namespace {
+
+MutexStats statsOf(char const * const name) {
+    for (auto & s : MutexStatsRegistry::instance().snapshot())
+        if (s.name == name)
+            return s;
+    SHAREMIND_TESTASSERT(false);
+    return {};
+}
+
+} // anonymous namespace
+
+int main() {
+    { // Uncontended acquisitions:
+        InstrumentedMutex<std::mutex> m("uncontended");
+        for (std::size_t i = 0u; i < 10u; ++i)
+            std::lock_guard<InstrumentedMutex<std::mutex> > const guard(m);
+        SHAREMIND_TESTASSERT(m.try_lock());
+        std::thread([&m]() { SHAREMIND_TESTASSERT(!m.try_lock()); }).join();
+        m.unlock();
+        auto const s(statsOf("uncontended"));
+        SHAREMIND_TESTASSERT(s.acquisitions == 11u);
+        SHAREMIND_TESTASSERT(s.contendedAcquisitions == 0u);
+        SHAREMIND_TESTASSERT(s.totalWaitTime.count() == 0);
+    }{ // Contended acquisitions and hold times:
+        using M = InstrumentedMutex<sharemind::TicketSpinLock>;
+        M m("contended");
+        m.lock();
+        std::thread t([&m]() { m.lock(); m.unlock(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        m.unlock();
+        t.join();
+        auto const s(statsOf("contended"));
+        SHAREMIND_TESTASSERT(s.acquisitions == 2u);
+        SHAREMIND_TESTASSERT(s.contendedAcquisitions == 1u);
+        SHAREMIND_TESTASSERT(s.totalWaitTime > std::chrono::milliseconds(0));
+        SHAREMIND_TESTASSERT(s.maxHoldTime >= std::chrono::milliseconds(20));
+    }{ // Instances with the same name share statistics:
+        InstrumentedMutex<std::mutex> a("shared");
+        InstrumentedMutex<std::mutex> b("shared");
+        a.lock();
+        a.unlock();
+        b.lock();
+        b.unlock();
+        SHAREMIND_TESTASSERT(statsOf("shared").acquisitions == 2u);
+    }{ // Mutual exclusion and use as a MutexType:
+        constexpr std::size_t numThreads = 4u;
+        constexpr std::size_t numIterations = 2000u;
+        InstrumentedMutex<std::mutex> m("counter");
+        std::size_t counter = 0u;
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0u; i < numThreads; ++i)
+            threads.emplace_back(
+                        [&m, &counter]() {
+                            for (std::size_t j = 0u; j < numIterations; ++j) {
+                                std::lock_guard<decltype(m)> const guard(m);
+                                ++counter;
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(counter == numThreads * numIterations);
+        SHAREMIND_TESTASSERT(statsOf("counter").acquisitions
+                             == numThreads * numIterations);
+
+        sharemind::CircBufferSCSP<
+                int,
+                sharemind::CircBufferScspLocking<
+                    InstrumentedMutex<std::mutex> > > buffer(4u);
+        int const v = 42;
+        buffer.write(&v, 1u);
+        SHAREMIND_TESTASSERT(statsOf("<unnamed>").acquisitions > 0u);
+    }{ // dump() and reset():
+        std::ostringstream oss;
+        MutexStatsRegistry::instance().dump(oss);
+        SHAREMIND_TESTASSERT(oss.str().find("contended: acquisitions=2 ")
+                             != std::string::npos);
+        MutexStatsRegistry::instance().reset();
+        SHAREMIND_TESTASSERT(statsOf("contended").acquisitions == 0u);
+    }
+}
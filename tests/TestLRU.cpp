@@ -26,6 +26,13 @@
 
 struct Elem {};
 
+struct Blob { std::size_t size; };
+
+struct BlobCost {
+    std::size_t operator()(Blob const & blob) const noexcept
+    { return blob.size; }
+};
+
 int main() {
     using sharemind::LRU;
 
@@ -60,4 +67,79 @@ int main() {
     lru.clear();
     SHAREMIND_TESTASSERT(elem1.use_count() == 1);
     SHAREMIND_TESTASSERT(elem2.use_count() == 1);
+    SHAREMIND_TESTASSERT(lru.size() == 0u);
+
+    { // Expired weak elements are reclaimed without being looked up:
+        LRU<std::size_t, Elem> lru2{10u};
+        auto const alive = std::make_shared<Elem>();
+        lru2.insert(0u, alive);
+        for (std::size_t i = 1u; i < 100000u; ++i)
+            lru2.insert(i, std::make_shared<Elem>());
+        SHAREMIND_TESTASSERT(lru2.size() <= 10u + 2u);
+        for (std::size_t i = 99990u; i < 100000u; ++i)
+            SHAREMIND_TESTASSERT(lru2.get(i));
+        // Weak element still alive elsewhere is kept:
+        SHAREMIND_TESTASSERT(alive.use_count() == 1);
+        SHAREMIND_TESTASSERT(lru2.get(0u) == alive);
+        SHAREMIND_TESTASSERT(alive.use_count() == 2);
+    }{ // Cost-weighted eviction and statistics:
+        LRU<int, Blob, BlobCost> lru3{100u};
+        auto const small1 = std::make_shared<Blob>(Blob{10u});
+        auto const small2 = std::make_shared<Blob>(Blob{20u});
+        auto const big = std::make_shared<Blob>(Blob{80u});
+        lru3.insert(1, small1);
+        lru3.insert(2, small2);
+        SHAREMIND_TESTASSERT(lru3.cost() == 30u);
+        SHAREMIND_TESTASSERT(lru3.get(1) == small1);
+        // Evicts only the least recently used item to get within budget:
+        lru3.insert(3, big);
+        SHAREMIND_TESTASSERT(lru3.cost() == 90u);
+        SHAREMIND_TESTASSERT(small2.use_count() == 1);
+        SHAREMIND_TESTASSERT(small1.use_count() == 2);
+        SHAREMIND_TESTASSERT(lru3.stats().evictions == 1u);
+        // Explicit cost larger than the limit:
+        lru3.insert(4, std::make_shared<Blob>(Blob{0u}), 1000u);
+        SHAREMIND_TESTASSERT(lru3.cost() == 0u);
+        SHAREMIND_TESTASSERT(lru3.stats().evictions == 4u);
+        SHAREMIND_TESTASSERT(!lru3.get(4));
+        SHAREMIND_TESTASSERT(lru3.get(2) == small2);
+        SHAREMIND_TESTASSERT(lru3.cost() == 20u);
+        SHAREMIND_TESTASSERT(!lru3.get(5));
+        SHAREMIND_TESTASSERT(lru3.stats().hits == 2u);
+        SHAREMIND_TESTASSERT(lru3.stats().misses == 2u);
+        lru3.resetStats();
+        SHAREMIND_TESTASSERT(lru3.stats().hits == 0u);
+        lru3.clear();
+        SHAREMIND_TESTASSERT(lru3.cost() == 0u);
+    }{ // Moving:
+        LRU<int, Elem> a{2u};
+        auto const e1 = std::make_shared<Elem>();
+        auto const e2 = std::make_shared<Elem>();
+        for (int i = 0; i < 100; ++i)
+            a.insert(i, std::make_shared<Elem>());
+        a.insert(100, e1);
+        a.insert(101, e2);
+        LRU<int, Elem> b(std::move(a));
+        SHAREMIND_TESTASSERT(a.size() == 0u);
+        SHAREMIND_TESTASSERT(a.cost() == 0u);
+        SHAREMIND_TESTASSERT(b.costLimit() == 2u);
+        SHAREMIND_TESTASSERT(b.cost() == 2u);
+        SHAREMIND_TESTASSERT(b.get(100) == e1);
+        SHAREMIND_TESTASSERT(b.get(101) == e2);
+        // The moved-from cache remains usable:
+        a.insert(1, e1);
+        SHAREMIND_TESTASSERT(a.get(1) == e1);
+        SHAREMIND_TESTASSERT(e1.use_count() == 3);
+        LRU<int, Elem> c{1u};
+        c.insert(7, e2);
+        c = std::move(b);
+        SHAREMIND_TESTASSERT(c.costLimit() == 2u);
+        SHAREMIND_TESTASSERT(c.get(7) == nullptr);
+        SHAREMIND_TESTASSERT(c.get(100) == e1);
+        SHAREMIND_TESTASSERT(b.size() == 0u);
+        c = LRU<int, Elem>{5u};
+        SHAREMIND_TESTASSERT(c.size() == 0u);
+        SHAREMIND_TESTASSERT(e1.use_count() == 2);
+        SHAREMIND_TESTASSERT(e2.use_count() == 1);
+    }
 }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/McsSpinLock.h"
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../src/TestAssert.h"
+#include "../src/TicketSpinLock.h"
+
+
+namespace {
+
+template <typename Lock>
+void testLock() {
+    { // try_lock():
+        Lock lock;
+        SHAREMIND_TESTASSERT(lock.try_lock());
+        std::thread([&lock]() { SHAREMIND_TESTASSERT(!lock.try_lock()); })
+                .join();
+        lock.unlock();
+        std::thread([&lock]() {
+                        SHAREMIND_TESTASSERT(lock.try_lock());
+                        lock.unlock();
+                    }).join();
+    }{ // Holding many locks at once, released out of order:
+        constexpr std::size_t numLocks = 20u;
+        Lock locks[numLocks];
+        for (auto & lock : locks)
+            lock.lock();
+        for (std::size_t i = 0u; i < numLocks; i += 2u)
+            locks[i].unlock();
+        for (std::size_t i = 1u; i < numLocks; i += 2u)
+            locks[i].unlock();
+    }{ // Mutual exclusion:
+        constexpr std::size_t numThreads = 4u;
+        constexpr std::size_t numIterations = 10000u;
+        Lock lock;
+        std::size_t counter = 0u;
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0u; i < numThreads; ++i)
+            threads.emplace_back(
+                        [&lock, &counter]() {
+                            for (std::size_t j = 0u; j < numIterations; ++j) {
+                                std::lock_guard<Lock> const guard(lock);
+                                ++counter;
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(counter == numThreads * numIterations);
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    testLock<sharemind::McsSpinLock>();
+    testLock<sharemind::TicketSpinLock>();
+    testLock<sharemind::ProportionalBackoffTicketSpinLock>();
+    testLock<sharemind::AdaptiveBackoffTicketSpinLock>();
+}
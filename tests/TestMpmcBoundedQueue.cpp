@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/MpmcBoundedQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+using sharemind::BlockingMpmcBoundedQueue;
+using sharemind::MpmcBoundedQueue;
+
+namespace {
+
+constexpr std::size_t numThreads = 4u;
+constexpr std::size_t numPerThread = 10000u;
+
+template <typename Queue>
+void testConcurrent(bool const bulk) {
+    Queue q(64u);
+    std::atomic<std::size_t> sum(0u);
+    std::atomic<std::size_t> popped(0u);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0u; t < numThreads; ++t) {
+        threads.emplace_back(
+                    [&q, t, bulk]() noexcept {
+                        std::size_t i = 0u;
+                        while (i < numPerThread) {
+                            std::size_t vs[3u];
+                            std::size_t n = 0u;
+                            for (; n < 3u && i + n < numPerThread; ++n)
+                                vs[n] = t * numPerThread + i + n + 1u;
+                            std::size_t const pushed =
+                                    bulk ? q.tryPushBulk(vs, n)
+                                         : (q.tryPush(std::move(vs[0u]))
+                                            ? 1u
+                                            : 0u);
+                            if (!pushed)
+                                std::this_thread::yield();
+                            i += pushed;
+                        }
+                    });
+        threads.emplace_back(
+                    [&q, &sum, &popped, bulk]() noexcept {
+                        constexpr auto total = numThreads * numPerThread;
+                        while (popped.load() < total) {
+                            std::size_t vs[5u];
+                            std::size_t const n =
+                                    bulk ? q.tryPopBulk(vs, 5u)
+                                         : (q.tryPop(vs[0u]) ? 1u : 0u);
+                            if (!n)
+                                std::this_thread::yield();
+                            for (std::size_t i = 0u; i < n; ++i)
+                                sum.fetch_add(vs[i]);
+                            popped.fetch_add(n);
+                        }
+                    });
+    }
+    for (auto & t : threads)
+        t.join();
+    constexpr auto total = numThreads * numPerThread;
+    SHAREMIND_TESTASSERT(popped.load() == total);
+    SHAREMIND_TESTASSERT(sum.load() == total * (total + 1u) / 2u);
+    SHAREMIND_TESTASSERT(q.sizeApprox() == 0u);
+}
+
+} // anonymous namespace
+
+int main() {
+    { // Basic FIFO semantics:
+        MpmcBoundedQueue<std::unique_ptr<int> > q(3u);
+        SHAREMIND_TESTASSERT(q.capacity() == 4u);
+        SHAREMIND_TESTASSERT(q.sizeApprox() == 0u);
+        std::unique_ptr<int> out;
+        SHAREMIND_TESTASSERT(!q.tryPop(out));
+        for (int i = 0; i < 4; ++i)
+            SHAREMIND_TESTASSERT(q.tryPush(std::make_unique<int>(i)));
+        SHAREMIND_TESTASSERT(q.sizeApprox() == 4u);
+        auto extra(std::make_unique<int>(4));
+        SHAREMIND_TESTASSERT(!q.tryPush(std::move(extra)));
+        SHAREMIND_TESTASSERT(extra); // Not moved from when full
+        for (int i = 0; i < 4; ++i) {
+            SHAREMIND_TESTASSERT(q.tryPop(out));
+            SHAREMIND_TESTASSERT(*out == i);
+        }
+        SHAREMIND_TESTASSERT(!q.tryPop(out));
+
+        // Wrap around and leave some elements for the destructor:
+        for (int i = 0; i < 3; ++i)
+            SHAREMIND_TESTASSERT(q.tryPush(std::make_unique<int>(i)));
+    }{ // Bulk operations:
+        MpmcBoundedQueue<int> q(8u);
+        int const in[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        SHAREMIND_TESTASSERT(q.tryPushBulk(in, 0u) == 0u);
+        SHAREMIND_TESTASSERT(q.tryPushBulk(in, 5u) == 5u);
+        SHAREMIND_TESTASSERT(q.tryPushBulk(in + 5, 5u) == 3u);
+        SHAREMIND_TESTASSERT(q.tryPushBulk(in, 1u) == 0u);
+        int out[10u];
+        SHAREMIND_TESTASSERT(q.tryPopBulk(out, 3u) == 3u);
+        SHAREMIND_TESTASSERT(q.tryPopBulk(out + 3, 10u) == 5u);
+        SHAREMIND_TESTASSERT(q.tryPopBulk(out, 10u) == 0u);
+        for (int i = 0; i < 8; ++i)
+            SHAREMIND_TESTASSERT(out[i] == i + 1);
+    }{ // Blocking operations:
+        BlockingMpmcBoundedQueue<int> q(2u);
+        int out = 0;
+        SHAREMIND_TESTASSERT(!q.popFor(out, std::chrono::milliseconds(1)));
+        std::thread consumer([&q]() noexcept {
+                                 for (int i = 0; i < 1000; ++i) {
+                                     int v = -1;
+                                     q.pop(v);
+                                     SHAREMIND_TESTASSERT(v == i);
+                                 }
+                             });
+        for (int i = 0; i < 1000; ++i)
+            q.push(i);
+        consumer.join();
+        q.push(42);
+        SHAREMIND_TESTASSERT(q.popFor(out, std::chrono::milliseconds(1)));
+        SHAREMIND_TESTASSERT(out == 42);
+    }
+
+    testConcurrent<MpmcBoundedQueue<std::size_t> >(false);
+    testConcurrent<MpmcBoundedQueue<std::size_t> >(true);
+    testConcurrent<BlockingMpmcBoundedQueue<std::size_t> >(false);
+    testConcurrent<BlockingMpmcBoundedQueue<std::size_t> >(true);
+}
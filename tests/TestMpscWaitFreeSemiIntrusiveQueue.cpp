@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/MpscWaitFreeSemiIntrusiveQueue.h"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+using sharemind::BlockingMpscWaitFreeSemiIntrusiveQueue;
+using sharemind::MpscWaitFreeSemiIntrusiveQueue;
+
+int main() {
+    using Q = MpscWaitFreeSemiIntrusiveQueue<int>;
+    using Node = Q::Node;
+    { // pop():
+        Q q;
+        SHAREMIND_TESTASSERT(q.empty());
+        SHAREMIND_TESTASSERT(!q.pop());
+        q.push(std::make_unique<Node>(1));
+        q.push(std::make_unique<Node>(2));
+        SHAREMIND_TESTASSERT(!q.empty());
+        auto n(q.pop());
+        SHAREMIND_TESTASSERT(n && n->data == 1);
+        n = q.pop();
+        SHAREMIND_TESTASSERT(n && n->data == 2);
+        SHAREMIND_TESTASSERT(q.empty());
+        SHAREMIND_TESTASSERT(!q.pop());
+    }{ // consumeBatch() and popAll():
+        Q q;
+        for (int i = 0; i < 10; ++i)
+            q.push(std::make_unique<Node>(i));
+        std::vector<std::unique_ptr<Node> > nodes;
+        auto const collect =
+                [&nodes](std::unique_ptr<Node> node) noexcept
+                { nodes.emplace_back(std::move(node)); };
+        SHAREMIND_TESTASSERT(q.consumeBatch(collect, 0u) == 0u);
+        SHAREMIND_TESTASSERT(q.consumeBatch(collect, 3u) == 3u);
+        SHAREMIND_TESTASSERT(nodes.size() == 3u);
+        SHAREMIND_TESTASSERT(q.popAll(collect) == 7u);
+        SHAREMIND_TESTASSERT(q.empty());
+        SHAREMIND_TESTASSERT(q.popAll(collect) == 0u);
+        SHAREMIND_TESTASSERT(nodes.size() == 10u);
+        for (int i = 0; i < 10; ++i)
+            SHAREMIND_TESTASSERT(nodes[static_cast<std::size_t>(i)]->data == i);
+
+        // Recycle the popped nodes from within the callback:
+        for (auto & node : nodes)
+            q.push(std::move(node));
+        int expected = 0;
+        SHAREMIND_TESTASSERT(
+                q.consumeBatch(
+                    [&q, &expected](std::unique_ptr<Node> node) noexcept {
+                        SHAREMIND_TESTASSERT(node->data == expected++);
+                        q.push(std::move(node));
+                    },
+                    10u) == 10u);
+        SHAREMIND_TESTASSERT(q.popAll([](std::unique_ptr<Node>) noexcept {})
+                             == 10u);
+    }{ // Blocking:
+        BlockingMpscWaitFreeSemiIntrusiveQueue<int> q;
+        SHAREMIND_TESTASSERT(!q.waitFor(std::chrono::milliseconds(1)));
+        constexpr int numProducers = 3;
+        constexpr int numPerProducer = 1000;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < numProducers; ++p)
+            producers.emplace_back(
+                        [&q]() noexcept {
+                            for (int i = 0; i < numPerProducer; ++i)
+                                q.push(std::make_unique<Node>(i));
+                        });
+        int total = 0;
+        long sum = 0;
+        while (total < numProducers * numPerProducer)
+            total += static_cast<int>(
+                        q.waitAndPopAll(
+                            [&sum](std::unique_ptr<Node> node) noexcept
+                            { sum += node->data; }));
+        for (auto & t : producers)
+            t.join();
+        SHAREMIND_TESTASSERT(total == numProducers * numPerProducer);
+        SHAREMIND_TESTASSERT(sum == numProducers * (numPerProducer - 1)
+                                    * numPerProducer / 2);
+        SHAREMIND_TESTASSERT(q.empty());
+        q.push(std::make_unique<Node>(42));
+        SHAREMIND_TESTASSERT(q.waitFor(std::chrono::milliseconds(1)));
+        auto n(q.pop());
+        SHAREMIND_TESTASSERT(n && n->data == 42);
+    }{ // Compact layout:
+        using CQ = MpscWaitFreeSemiIntrusiveQueue<int, true>;
+        static_assert(sizeof(CQ::Node) < sizeof(Node), "");
+        CQ q;
+        q.push(std::make_unique<CQ::Node>(1));
+        q.push(std::make_unique<CQ::Node>(2));
+        auto n(q.pop());
+        SHAREMIND_TESTASSERT(n && n->data == 1);
+        n = q.pop();
+        SHAREMIND_TESTASSERT(n && n->data == 2);
+        SHAREMIND_TESTASSERT(!q.pop());
+    }{ // Node pool:
+        using CQ = BlockingMpscWaitFreeSemiIntrusiveQueue<int, true>;
+        CQ::NodePool pool(2u);
+        SHAREMIND_TESTASSERT(pool.capacity() == 2u);
+        auto n1(pool.acquire(1));
+        auto n2(pool.acquire(2));
+        auto n3(pool.acquire(3));
+        SHAREMIND_TESTASSERT(n1->data == 1);
+        auto const p1 = n1.get();
+        auto const p2 = n2.get();
+        pool.release(std::move(n1));
+        pool.release(std::move(n2));
+        pool.release(std::move(n3)); // Pool full, deleted
+        n1 = pool.acquire(4);
+        n2 = pool.acquire(5);
+        SHAREMIND_TESTASSERT(n1.get() == p1);
+        SHAREMIND_TESTASSERT(n2.get() == p2);
+        SHAREMIND_TESTASSERT(n1->data == 4);
+        SHAREMIND_TESTASSERT(n2->data == 5);
+        pool.release(std::move(n1));
+        pool.release(std::move(n2));
+
+        // Producers reusing the nodes returned by the consumer:
+        CQ q;
+        constexpr int numProducers = 3;
+        constexpr int numPerProducer = 1000;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < numProducers; ++p)
+            producers.emplace_back(
+                        [&q, &pool]() {
+                            for (int i = 0; i < numPerProducer; ++i)
+                                q.push(pool.acquire(i));
+                        });
+        int total = 0;
+        long sum = 0;
+        while (total < numProducers * numPerProducer)
+            total += static_cast<int>(
+                        q.waitAndPopAll(
+                            [&sum, &pool](
+                                    std::unique_ptr<CQ::Node> node) noexcept
+                            {
+                                sum += node->data;
+                                pool.release(std::move(node));
+                            }));
+        for (auto & t : producers)
+            t.join();
+        SHAREMIND_TESTASSERT(sum == numProducers * (numPerProducer - 1)
+                                    * numPerProducer / 2);
+    }
+}
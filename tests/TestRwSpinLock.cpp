@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RwSpinLock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+using sharemind::RwSpinLock;
+
+int main() {
+    { // try_lock() and try_lock_shared():
+        RwSpinLock lock;
+        SHAREMIND_TESTASSERT(lock.try_lock_shared());
+        SHAREMIND_TESTASSERT(lock.try_lock_shared());
+        std::thread([&lock]() {
+                        SHAREMIND_TESTASSERT(!lock.try_lock());
+                        SHAREMIND_TESTASSERT(lock.try_lock_shared());
+                        lock.unlock_shared();
+                    }).join();
+        lock.unlock_shared();
+        lock.unlock_shared();
+        SHAREMIND_TESTASSERT(lock.try_lock());
+        std::thread([&lock]() {
+                        SHAREMIND_TESTASSERT(!lock.try_lock());
+                        SHAREMIND_TESTASSERT(!lock.try_lock_shared());
+                    }).join();
+        lock.unlock();
+        SHAREMIND_TESTASSERT(lock.try_lock());
+        lock.unlock();
+    }{ // Readers always observe consistent state:
+        constexpr std::size_t numReaders = 4u;
+        constexpr std::size_t numWriters = 2u;
+        constexpr std::size_t numIterations = 5000u;
+        RwSpinLock lock;
+        std::size_t a = 0u;
+        std::size_t b = 0u;
+        std::atomic<bool> inconsistent(false);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0u; i < numWriters; ++i)
+            threads.emplace_back(
+                        [&]() {
+                            for (std::size_t j = 0u; j < numIterations; ++j) {
+                                std::lock_guard<RwSpinLock> const guard(lock);
+                                ++a;
+                                std::this_thread::yield();
+                                ++b;
+                            }
+                        });
+        for (std::size_t i = 0u; i < numReaders; ++i)
+            threads.emplace_back(
+                        [&]() {
+                            for (std::size_t j = 0u; j < numIterations; ++j) {
+                                std::shared_lock<RwSpinLock> const guard(lock);
+                                if (a != b)
+                                    inconsistent = true;
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(!inconsistent);
+        SHAREMIND_TESTASSERT(a == numWriters * numIterations);
+        SHAREMIND_TESTASSERT(b == numWriters * numIterations);
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/SeqLock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+namespace {
+
+struct Snapshot {
+    std::size_t values[5u];
+    char tag;
+};
+
+struct NoDefault {
+    constexpr NoDefault(int const v) noexcept : value(v) {}
+    int value;
+};
+
+} // anonymous namespace
+
+int main() {
+    using sharemind::SeqLock;
+    { // Basic operations:
+        SeqLock<int> lock(42);
+        SHAREMIND_TESTASSERT(lock.load() == 42);
+        lock.store(3);
+        SHAREMIND_TESTASSERT(lock.load() == 3);
+        lock.update([](int & v) noexcept { v *= 5; });
+        SHAREMIND_TESTASSERT(lock.load() == 15);
+        try {
+            lock.update([](int & v) { v = 1; throw 7; });
+            SHAREMIND_TESTASSERT(false);
+        } catch (int const e) {
+            SHAREMIND_TESTASSERT(e == 7);
+        }
+        SHAREMIND_TESTASSERT(lock.load() == 15);
+        lock.store(16); // Must not deadlock after the exception
+        SHAREMIND_TESTASSERT(lock.load() == 16);
+    }{ // Types which are not default constructible:
+        SeqLock<NoDefault> lock(NoDefault(1));
+        SHAREMIND_TESTASSERT(lock.load().value == 1);
+        lock.update([](NoDefault & v) noexcept { v.value += 2; });
+        SHAREMIND_TESTASSERT(lock.load().value == 3);
+    }{ // Readers never observe torn values:
+        constexpr std::size_t numReaders = 3u;
+        constexpr std::size_t numWriters = 2u;
+        constexpr std::size_t numIterations = 10000u;
+        SeqLock<Snapshot> lock;
+        std::atomic<bool> torn(false);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0u; i < numWriters; ++i)
+            threads.emplace_back(
+                        [&lock]() {
+                            for (std::size_t j = 0u; j < numIterations; ++j) {
+                                lock.update(
+                                        [](Snapshot & s) noexcept {
+                                            for (auto & v : s.values)
+                                                ++v;
+                                            s.tag = static_cast<char>(
+                                                        s.values[0u]);
+                                        });
+                                if (!(j % 64u))
+                                    std::this_thread::yield();
+                            }
+                        });
+        for (std::size_t i = 0u; i < numReaders; ++i)
+            threads.emplace_back(
+                        [&lock, &torn]() {
+                            for (std::size_t j = 0u; j < numIterations; ++j) {
+                                auto const s(lock.load());
+                                for (auto const v : s.values)
+                                    if (v != s.values[0u])
+                                        torn = true;
+                                if (s.tag != static_cast<char>(s.values[0u]))
+                                    torn = true;
+                            }
+                        });
+        for (auto & t : threads)
+            t.join();
+        SHAREMIND_TESTASSERT(!torn);
+        auto const s(lock.load());
+        for (auto const v : s.values)
+            SHAREMIND_TESTASSERT(v == numWriters * numIterations);
+    }
+}
@@ -20,7 +20,7 @@
 #include "../src/SharedResourceMap.h"
 
 #include <atomic>
-// #include <chrono>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -86,6 +86,12 @@ bool fail = true;
 
 sharemind::SharedResourceMap<unsigned, SomeClass> map;
 
+struct OrderedKey {
+    bool operator<(OrderedKey const & rhs) const noexcept
+    { return value < rhs.value; }
+    unsigned value;
+};
+
 } // anonymous namespace
 
 void threadFun() noexcept {
@@ -188,6 +194,91 @@ int main() {
     SHAREMIND_TESTASSERT(might_fail_with_very_low_probability_or_valgrind(
                              constructions.load(relax) < maxConstructions));
 
-    /// \todo Test forEach()
-    /// \todo Test waitForEmpty()
+    { // forEach():
+        auto a = map.getResource(1u, constr);
+        auto b = map.getResource(2u, constr);
+        unsigned sum = 0u;
+        unsigned calls = 0u;
+        map.forEach([&](unsigned const key,
+                        std::shared_ptr<SomeClass> ptr) noexcept
+                    {
+                        SHAREMIND_TESTASSERT(ptr->value == key);
+                        sum += key;
+                        ++calls;
+                    });
+        SHAREMIND_TESTASSERT(calls == 2u);
+        SHAREMIND_TESTASSERT(sum == 3u);
+    }
+    SHAREMIND_TESTASSERT(map.empty());
+
+    { // Construction happens outside of the lock of the shard:
+        sharemind::SharedResourceMap<unsigned, SomeClass> m(1u);
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool constructing = false;
+        bool release = false;
+        std::atomic<unsigned> slowConstructions(0u);
+        auto const slowConstr =
+                [&](unsigned const v) {
+                    inc(slowConstructions);
+                    std::unique_lock<std::mutex> lock(mutex);
+                    constructing = true;
+                    cond.notify_all();
+                    cond.wait(lock, [&]() noexcept { return release; });
+                    return new SomeClass(v);
+                };
+        std::shared_ptr<SomeClass> r1;
+        std::shared_ptr<SomeClass> r2;
+        std::thread t1([&]() { r1 = m.getResource(1u, slowConstr); });
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() noexcept { return constructing; });
+        }
+        // A concurrent request for the same key waits for the construction:
+        std::thread t2([&]() { r2 = m.getResource(1u, slowConstr); });
+        // Other keys in the same shard are not blocked:
+        SHAREMIND_TESTASSERT(m.getResource(2u, constr)->value == 2u);
+        SHAREMIND_TESTASSERT(m.size() == 1u);
+        {
+            std::lock_guard<std::mutex> const guard(mutex);
+            release = true;
+            cond.notify_all();
+        }
+        t1.join();
+        t2.join();
+        SHAREMIND_TESTASSERT(r1);
+        SHAREMIND_TESTASSERT(r1 == r2);
+        SHAREMIND_TESTASSERT(slowConstructions == 1u);
+
+        // waitForEmpty():
+        std::thread t3([&]() {
+                           std::this_thread::sleep_for(
+                                   std::chrono::milliseconds(10));
+                           r1.reset();
+                           r2.reset();
+                       });
+        m.waitForEmpty();
+        SHAREMIND_TESTASSERT(m.empty());
+        t3.join();
+    }{ // Failed constructions are retried:
+        sharemind::SharedResourceMap<unsigned, SomeClass> m;
+        try {
+            m.getResource(1u, [](unsigned) -> SomeClass * { throw 1; });
+            SHAREMIND_TESTASSERT(false);
+        } catch (int const e) {
+            SHAREMIND_TESTASSERT(e == 1);
+        }
+        SHAREMIND_TESTASSERT(m.empty());
+        SHAREMIND_TESTASSERT(m.getResource(1u, constr)->value == 1u);
+    }{ // Keys which are only comparable with operator<:
+        sharemind::SharedResourceMap<OrderedKey, SomeClass> m;
+        auto const orderedConstr =
+                [](OrderedKey const & k) { return new SomeClass(k.value); };
+        auto const r1(m.getResource(OrderedKey{1u}, orderedConstr));
+        auto const r2(m.getResource(OrderedKey{2u}, orderedConstr));
+        SHAREMIND_TESTASSERT(r1->value == 1u);
+        SHAREMIND_TESTASSERT(r2->value == 2u);
+        SHAREMIND_TESTASSERT(m.getResource(OrderedKey{1u}) == r1);
+        SHAREMIND_TESTASSERT(m.size() == 2u);
+    }
 }
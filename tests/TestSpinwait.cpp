@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/Spinwait.h"
+
+#include <chrono>
+#include <cstddef>
+#include "../src/TestAssert.h"
+
+
+using sharemind::SpinWaiter;
+
+int main() {
+    // Calibrated during static initialization, not on first use:
+    SHAREMIND_TESTASSERT(
+                sharemind::Detail::Spinwait::spinWaitsPerMicrosecond().load()
+                > 0u);
+    SHAREMIND_TESTASSERT(sharemind::spinWaitsPerMicrosecond() > 0u);
+    SHAREMIND_TESTASSERT(sharemind::calibrateSpinWait() > 0u);
+
+    { // Escalates to yielding once the budget is spent:
+        SpinWaiter waiter(std::chrono::microseconds(5), 8u);
+        std::size_t waits = 0u;
+        while (!waiter.isYielding()) {
+            waiter.wait();
+            SHAREMIND_TESTASSERT(++waits < 1000000u);
+        }
+        waiter.wait();
+        SHAREMIND_TESTASSERT(waiter.isYielding());
+        waiter.reset();
+        SHAREMIND_TESTASSERT(!waiter.isYielding());
+    }{ // A zero budget yields immediately:
+        SpinWaiter waiter(std::chrono::nanoseconds(0), 1u);
+        SHAREMIND_TESTASSERT(waiter.isYielding());
+        waiter.wait();
+    }{ // Process-wide defaults:
+        auto const oldBudget(SpinWaiter::defaultSpinBudget());
+        auto const oldMaxBackoff(SpinWaiter::defaultMaxBackoff());
+        SpinWaiter::setDefaultSpinBudget(std::chrono::nanoseconds(0));
+        SpinWaiter::setDefaultMaxBackoff(4u);
+        SHAREMIND_TESTASSERT(SpinWaiter::defaultMaxBackoff() == 4u);
+        SHAREMIND_TESTASSERT(SpinWaiter().isYielding());
+        SpinWaiter::setDefaultSpinBudget(oldBudget);
+        SpinWaiter::setDefaultMaxBackoff(oldMaxBackoff);
+        SHAREMIND_TESTASSERT(SpinWaiter::defaultSpinBudget() == oldBudget);
+    }
+}
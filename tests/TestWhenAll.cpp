@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/WhenAll.h"
+
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+using sharemind::Future;
+using sharemind::Promise;
+using sharemind::makeExceptionalFuture;
+using sharemind::makeReadyFuture;
+using sharemind::whenAll;
+
+struct E {};
+
+int main() {
+    { // Empty:
+        auto f(whenAll());
+        static_assert(std::is_same<decltype(f), Future<std::tuple<> > >::value,
+                      "");
+        SHAREMIND_TESTASSERT(f.isReady());
+        f.takeValue();
+
+        std::vector<Future<int> > futures;
+        auto f2(whenAll(futures));
+        SHAREMIND_TESTASSERT(f2.isReady());
+        SHAREMIND_TESTASSERT(f2.takeValue().empty());
+    }
+    { // Heterogeneous:
+        Promise<int> p1;
+        Promise<void> p2;
+        auto f(whenAll(p1.takeFuture(),
+                       p2.takeFuture(),
+                       makeExceptionalFuture<long>(E())));
+        static_assert(
+                std::is_same<
+                    decltype(f),
+                    Future<std::tuple<Future<int>, Future<void>, Future<long> > >
+                >::value, "");
+        SHAREMIND_TESTASSERT(!f.isReady());
+        p2.setReady();
+        SHAREMIND_TESTASSERT(!f.isReady());
+        p1.setValue(42);
+        SHAREMIND_TESTASSERT(f.isReady());
+        auto r(f.takeValue());
+        SHAREMIND_TESTASSERT(std::get<0>(r).takeValue() == 42);
+        std::get<1>(r).takeValue();
+        try {
+            std::get<2>(r).takeValue();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (E const &) {}
+    }
+    { // Range, set from several threads:
+        constexpr std::size_t const numFutures = 100u;
+        std::vector<Promise<std::size_t> > promises(numFutures);
+        std::vector<Future<std::size_t> > futures;
+        for (auto & p : promises)
+            futures.emplace_back(p.takeFuture());
+        auto f(whenAll(futures));
+        static_assert(
+                std::is_same<
+                    decltype(f),
+                    Future<std::vector<Future<std::size_t> > >
+                >::value, "");
+        SHAREMIND_TESTASSERT(!f.isReady());
+        {
+            std::vector<std::thread> threads;
+            for (std::size_t i = 0u; i < numFutures; ++i)
+                threads.emplace_back(
+                        [&promises, i]() noexcept
+                        { promises[i].setValue(i); });
+            for (auto & t : threads)
+                t.join();
+        }
+        auto r(f.takeValue());
+        SHAREMIND_TESTASSERT(r.size() == numFutures);
+        for (std::size_t i = 0u; i < numFutures; ++i)
+            SHAREMIND_TESTASSERT(r[i].takeValue() == i);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/WhenAny.h"
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "../src/TestAssert.h"
+
+
+using sharemind::Future;
+using sharemind::Promise;
+using sharemind::WhenAnyResult;
+using sharemind::makeReadyFuture;
+using sharemind::whenAny;
+
+int main() {
+    {
+        Promise<int> p1;
+        Promise<int> p2;
+        Promise<int> p3;
+        auto f(whenAny(p1.takeFuture(), p2.takeFuture(), p3.takeFuture()));
+        static_assert(
+                std::is_same<decltype(f), Future<WhenAnyResult<int> > >::value,
+                "");
+        SHAREMIND_TESTASSERT(!f.isReady());
+        p2.setValue(2);
+        SHAREMIND_TESTASSERT(f.isReady());
+        p1.setValue(1);
+        auto r(f.takeValue());
+        SHAREMIND_TESTASSERT(r.index == 1u);
+        SHAREMIND_TESTASSERT(r.future.takeValue() == 2);
+    }{
+        std::vector<Promise<void> > promises(10u);
+        std::vector<Future<void> > futures;
+        for (auto & p : promises)
+            futures.emplace_back(p.takeFuture());
+        auto f(whenAny(futures));
+        SHAREMIND_TESTASSERT(!f.isReady());
+        promises[7u].setReady();
+        auto r(f.takeValue());
+        SHAREMIND_TESTASSERT(r.index == 7u);
+        r.future.takeValue();
+        promises.clear(); // Breaks the other promises
+    }{
+        auto f(whenAny(makeReadyFuture(42)));
+        SHAREMIND_TESTASSERT(f.isReady());
+        SHAREMIND_TESTASSERT(f.takeValue().future.takeValue() == 42);
+    }{
+        std::vector<Future<int> > futures;
+        auto f(whenAny(futures));
+        SHAREMIND_TESTASSERT(f.isReady());
+        try {
+            f.takeValue();
+            SHAREMIND_TEST_UNREACHABLE;
+        } catch (sharemind::WhenAnyEmptyRangeException const &) {}
+    }
+}